@@ -6,6 +6,19 @@
 
 void bgy3d_fft_mat_create (const int N[3], Mat *A, DA *da, DA *dc);
 
+/* FFTW planner flags according to --fft-planner: */
+unsigned bgy3d_fft_planner (void);
+
+/* Is the complex array descriptor for transposed k-space layout? */
+bool bgy3d_fft_transposed (const DA dc);
+
+/* Single precision transforms, for the early iterations: */
+void bgy3d_fft_mat_single (Mat A, bool single);
+
+/* Batched versions of MatMult() and MatMultTranspose(): */
+void bgy3d_fft_mat_mult_many (Mat A, int m, Vec x[m], Vec y[m]);
+void bgy3d_fft_mat_mult_transpose_many (Mat A, int m, Vec x[m], Vec y[m]);
+
 void bgy3d_fft_interp (const Mat A,
                        const Vec Y, /* complex, intent(in) */
                        int np, double x[np][3], /* intent(in) */
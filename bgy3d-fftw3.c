@@ -11,28 +11,85 @@
  */
 
 #include "bgy3d.h"              /* KFREQ(), M_PI */
+#include "bgy3d-getopt.h"       /* bgy3d_getopt_string() */
 #include <assert.h>
 #include <fftw3.h>
 #include <fftw3-mpi.h>
 #include "bgy3d-vec.h"          /* da_ref() */
 #include "bgy3d-fftw.h"         /* Common interface for two impls */
+#include "bgy3d-pencil.h"       /* bgy3d_pencil_create() */
 #include <complex.h>            /* after fftw.h */
+#ifdef _OPENMP
+#include <omp.h>                /* omp_get_max_threads() */
+#endif
+
+/* Batch sizes with plans kept, see many_plans(): */
+#define MAX_MANY 8
 
 typedef struct {
   /* Array  descriptors for real  and complex  vectors that  share the
      distribution pattern with FFTW-MPI: */
   DA da, dc;
 
-  /* Two plans for doubl -> cmplx and cmplx -> doubl: */
+  /*
+    Two plans for doubl -> Vec (out-of-place) and doubl -> doubl (in
+    place).  See mat_mult_fft() and mat_mult_transpose_fft():
+  */
   fftw_plan fw, bw;
 
   /*
     Storage for a PADDED array  of reals and complex numbers. The last
     dimension of the double array is  2 (N/2 + 1), that of the complex
-    array just N/2 + 1:
+    array just N/2 + 1. The complex array is only allocated on demand,
+    see mat_mult_fft():
   */
   double *doubl;
   fftw_complex *cmplx;
+
+  /* Local storage size  in complex numbers as required by FFTW: */
+  ptrdiff_t alloc_local;
+
+  /*
+    Alternative  to the slab decomposition  of FFTW-MPI, NULL if unused.
+    None of the slab plans and buffers above are allocated otherwise:
+  */
+  Pencil *pencil;
+
+  /*
+    With  transposed k-space  layout  (--fft-transposed) FFTW  skips
+    the final  all-to-all  exchange of  the  forward  transform and
+    expects  the same  layout on  input to the  inverse one.   The
+    complex array  is then laid  out as [j][k][i]  and is distributed
+    along N[1], see bgy3d_fft_mat_create():
+  */
+  bool transposed;
+
+  /*
+    Single precision plans and storage, see bgy3d_fft_mat_single().
+    Created on the first use. Both plans are in-place:
+  */
+  bool single;
+  fftwf_plan fw_single, bw_single;
+  float *floats;
+
+  /*
+    Batched plans for  m interleaved transforms at once,  see many_plans()
+    below.  Created on the first use of each m and kept, at most
+    MAX_MANY of them, the oldest goes  first.  The Krylov solver of
+    the response  code uses a few batch sizes  in turn.  All plans
+    operate in-place on the same buffer that grows with the largest m,
+    the  padded real view and  the complex view  share the storage:
+  */
+  int n_many, next_many;
+  struct { int m; fftw_plan fw, bw; } many_plan[MAX_MANY];
+  double *many;
+  ptrdiff_t many_size;          /* in complex numbers */
+
+  /* Same in single precision, see many_plans_single(): */
+  int n_many_single, next_many_single;
+  struct { int m; fftwf_plan fw, bw; } many_plan_single[MAX_MANY];
+  float *many_single;
+  ptrdiff_t many_size_single;
 } FFT;
 
 /*
@@ -53,168 +110,334 @@ static void shape (const FFT *fft, int *NI, int *NJ, int *NK)
 
 static const int debug = 0;
 
-/* doubl := Vec, for forward FFT */
-static void unpack_real (FFT *fft, Vec g, double *restrict doubl)
-{
-  int i0, j0, k0, ni, nj, nk, NI, NJ, NK;
-
-  /* Get local portion of the grid */
-  DMDAGetCorners (fft->da, &i0, &j0, &k0, &ni, &nj, &nk);
-
-  /* Get the official (full) dimension of the grid: */
-  shape (fft, &NI, &NJ, &NK);
+/*
+  Complex array descriptors for the transposed k-space layout carry a
+  tag, see bgy3d_fft_transposed():
+*/
+static PetscInt transposed_tag = -1;
 
-  /* Padded (physically the last) dimension. */
-  const int nip = 2 * (NI / 2 + 1);
-  if (debug)
-    printf ("unpack_real: shape = %d %d %d\n", nk, nj, nip);
-  assert (ni < nip);
+/*
+  Planner flags and the on-disk store of FFTW wisdom. Plans made with
+  FFTW_MEASURE  and  more  rigorous  flags  are  much  more  expensive
+  upfront, a cost worth  paying once for  the few  grid shapes one  is
+  usually running  over and over  again.  The  wisdom  file  records
+  these plans.  FFTW keys  the wisdom by the problem  size  and  kind
+  internally, MPI plans additionally depend on the number of workers.
+  For  that reason  the file  name is  suffixed by the  size  of  the
+  world, as in "wisdom.np8".
+
+  The settings  are read once, on  the first use. This  happens either
+  in bgy3d_fft_mat_create(), which is collective, or in rism-dst.c for
+  1D transforms which is not necessarily so.  The file is read by each
+  worker on the first  1D use and by rank 0, with a  broadcast, on the
+  first collective use.  It is written once, at exit.
+*/
+static unsigned planner = FFTW_ESTIMATE;
+static char wisdom[256] = "";   /* empty = no wisdom file */
+static bool wisdom_loaded = false, wisdom_broadcast = false;
+static bool wisdom_gather = false; /* any MPI plans made? */
 
-  /* The  view of  local FFT  padded storage  as a  3d array  with the
-     proper highest dimension: */
-  double (*const view)[nk][nj][nip] =(double (*)[nk][nj][nip]) doubl;
 
-  /* loop over local portion of grid */
-  {
-    double ***g_;
-    DMDAVecGetArray (fft->da, g, &g_);
+/*
+  Executed by exit().  All workers exit together,  the same as in the
+  pool of  States  in bgy3d.c.  Merges the wisdom of MPI plans on rank
+  0, which adds the  1D plans from rism-dst.c, if any, and writes the
+  file:
+*/
+static void wisdom_save_at_exit (void)
+{
+  if (planner == FFTW_ESTIMATE)
+    return;
 
-    /* NOTE: array pointed at by view is padded: */
-    for (int k = 0; k < nk; k++)
-      for (int j = 0; j < nj; j++)
-        for (int i = 0; i < ni; i++)
-          (*view)[k][j][i] = g_[k0 + k][j0 + j][i0 + i];
+  if (wisdom_gather)
+    fftw_mpi_gather_wisdom (comm_world_petsc);
 
-    DMDAVecRestoreArray (fft->da, g, &g_);
-  }
+  /* Only one writer, also when workers run independently: */
+  if (comm_rank () == 0)
+    if (!fftw_export_wisdom_to_filename (wisdom))
+      PRINTF ("Warning: failed to write FFTW wisdom to %s\n", wisdom);
 }
 
 
-/* Vec := doubl, for inverse FFT */
-static void pack_real (FFT *fft, Vec g, const double *restrict doubl)
+static void wisdom_load (bool collective)
 {
-  int i0, j0, k0, ni, nj, nk, NI, NJ, NK;
-
-  /* Get local portion of the grid */
-  DMDAGetCorners (fft->da, &i0, &j0, &k0, &ni, &nj, &nk);
-
-  /* Get the official (full) dimension of the grid: */
-  shape (fft, &NI, &NJ, &NK);
+  if (!*wisdom)
+    return;
 
-  /* Padded (physically the last) dimension. */
-  const int nip = 2 * (NI / 2 + 1);
-  if (debug)
-    printf ("pack_real: shape = %d %d %d\n", nk, nj, nip);
-  assert (ni < nip);
-
-  /* The  view of  local FFT  padded storage  as a  3d array  with the
-     proper highest dimension: */
-  double (*const view)[nk][nj][nip] =(double (*)[nk][nj][nip]) doubl;
-
-  /* loop over local portion of grid */
-  {
-    double ***g_;
-    DMDAVecGetArray (fft->da, g, &g_);
+  if (collective && !wisdom_broadcast)
+    {
+      /* Read once, and distribute to everyone: */
+      if (comm_rank () == 0 && !wisdom_loaded)
+        fftw_import_wisdom_from_filename (wisdom);
 
-    /* NOTE: array pointed at by view is padded: */
-    for (int k = 0; k < nk; k++)
-      for (int j = 0; j < nj; j++)
-        for (int i = 0; i < ni; i++)
-          g_[k0 + k][j0 + j][i0 + i] = (*view)[k][j][i];
+      fftw_mpi_broadcast_wisdom (comm_world_petsc);
 
-    DMDAVecRestoreArray (fft->da, g, &g_);
-  }
+      wisdom_broadcast = true;
+      wisdom_loaded = true;
+    }
+  else if (!wisdom_loaded)
+    {
+      fftw_import_wisdom_from_filename (wisdom); /* may fail, first run */
+      wisdom_loaded = true;
+    }
 }
 
 
-/* Vec := cmplx, for forward FFT */
-static void pack_cmplx (FFT *fft, Vec g, /* const */ fftw_complex *cmplx)
+/* Wisdom of the MPI plans is gathered at exit, see above: */
+static void wisdom_save (void)
 {
-  int i0, j0, k0, ni, nj, nk, NI, NJ, NK;
+  wisdom_gather = true;
+}
 
-  /* Get local portion of the grid */
-  DMDAGetCorners (fft->dc, &i0, &j0, &k0, &ni, &nj, &nk);
 
-  /* Get the official (full) dimension of the grid: */
-  shape (fft, &NI, &NJ, &NK);
+static void fft_init (bool collective)
+{
+  static bool fftw_mpi_init_called = false;
 
-  /* Padded (physically the last) dimension: */
-  const int nip = NI / 2 + 1;
-  if (debug)
-    printf ("pack_cmplx: shape = %d %d %d\n", nk, nj, nip);
+  /* FIXME: find a better place: */
+  if (!fftw_mpi_init_called)
+    {
+#ifdef _OPENMP
+      /*
+        Hybrid mode: each MPI worker runs --threads n threads, in FFTW
+        and in the grid loops  of bgy3d-vec.h.  Threads need to be set
+        up before MPI.  Plans made afterwards use all of them:
+      */
+      {
+        int nt = omp_get_max_threads ();
+        if (bgy3d_getopt_int ("threads", &nt))
+          omp_set_num_threads (nt);
 
-  /*
-    Otherwise  we  cannot  convert  between complex  and  half-complex
-    locally (this is probably also the  reason why there is no real to
-    half-complex transforms in FFTW3 MPI):
-  */
-  assert (ni == nip);
-  assert (i0 == 0);
+        fftw_init_threads ();
+        fftw_plan_with_nthreads (nt);
 
-  /* The view  of local  FFT complex  storage as a  3d array  with the
-     proper highest dimension: */
-  complex (*const view)[nk][nj][nip] = (complex (*)[nk][nj][nip]) cmplx;
+        fftwf_init_threads ();
+        fftwf_plan_with_nthreads (nt);
+      }
+#endif
+      fftw_mpi_init ();          /* required */
+      atexit (fftw_mpi_cleanup); /* required */
 
-  /* loop over local portion of grid */
-  {
-    complex ***g_;
+      /* Single precision is a separate library: */
+      fftwf_mpi_init ();
+      atexit (fftwf_mpi_cleanup);
+      fftw_mpi_init_called = true;
+
+      char buf[32] = "estimate";
+      bgy3d_getopt_string ("fft-planner", sizeof buf, buf);
+
+      if (strcmp (buf, "estimate") == 0)
+        planner = FFTW_ESTIMATE;
+      else if (strcmp (buf, "measure") == 0)
+        planner = FFTW_MEASURE;
+      else if (strcmp (buf, "patient") == 0)
+        planner = FFTW_PATIENT;
+      else if (strcmp (buf, "exhaustive") == 0)
+        planner = FFTW_EXHAUSTIVE;
+      else
+        {
+          PRINTF ("No such FFT planner: %s\n", buf);
+          exit (1);
+        }
 
-    DMDAVecGetArray (fft->dc, g, &g_);
+      char path[sizeof wisdom - 16];
+      if (bgy3d_getopt_string ("fft-wisdom", sizeof path, path))
+        {
+          snprintf (wisdom, sizeof wisdom, "%s.np%d", path, comm_size ());
 
-    /* loop over local portion of grid */
-    for (int k = 0; k < nk; k++)
-      for (int j = 0; j < nj; j++)
-        for (int i = 0; i < nip; i++)
-          g_[k0 + k][j0 + j][i0 + i] = (*view)[k][j][i];
+          /*
+            Handlers  are executed  in the  reverse order,  this one
+            before fftw_mpi_cleanup():
+          */
+          atexit (wisdom_save_at_exit);
+        }
+    }
 
-    DMDAVecRestoreArray (fft->dc, g, &g_);
-  }
+  wisdom_load (collective);
 }
 
 
-/* cmplx := Vec, for inverse FFT */
-static void unpack_cmplx (FFT *fft, Vec g, fftw_complex *cmplx)
+/* Planner flags for serial plans, e.g. in rism-dst.c: */
+unsigned bgy3d_fft_planner (void)
 {
-  int i0, j0, k0, ni, nj, nk, NI, NJ, NK;
-
-  /* Get local portion of the grid */
-  DMDAGetCorners (fft->dc, &i0, &j0, &k0, &ni, &nj, &nk);
-
-  /* Get the official (full) dimension of the grid: */
-  shape (fft, &NI, &NJ, &NK);
-
-  /* Padded (physically the last) dimension: */
-  const int nip = NI / 2 + 1;
-  if (debug)
-    printf ("unpack_cmplx: shape = %d %d %d\n", nk, nj, nip);
-  assert (ni < 2 * nip);
+  fft_init (false);
+  return planner;
+}
 
-  /*
-    Otherwise  we  cannot  convert  between complex  and  half-complex
-    locally (this is probably also the  reason why there is no real to
-    half-complex transforms in FFTW3 MPI):
-  */
-  assert (ni == nip);
-  assert (i0 == 0);
 
-  /* The view  of local  FFT complex  storage as a  3d array  with the
-     proper highest dimension: */
-  complex (*const view)[nk][nj][nip] = (complex (*)[nk][nj][nip]) cmplx;
+/*
+  True if  the complex  array descriptor  dc describes  the transposed
+  k-space layout. The dimensions 1 and 2 of dc are then swapped with
+  respect to the real grid, see kspace_dims() in bgy3d-vec.h:
+*/
+bool bgy3d_fft_transposed (const DA dc)
+{
+  if (transposed_tag < 0)
+    return false;
 
-  /* loop over local portion of grid */
-  {
-    complex ***g_;
+  PetscInt tag;
+  PetscBool flag;
+  PetscObjectComposedDataGetInt ((PetscObject) dc, transposed_tag, tag, flag);
 
-    DMDAVecGetArray (fft->dc, g, &g_);
+  return flag && tag;
+}
 
-    for (int k = 0; k < nk; k++)
-      for (int j = 0; j < nj; j++)
-        for (int i = 0; i < nip; i++)
-          (*view)[k][j][i] = g_[k0 + k][j0 + j][i0 + i];
 
-    DMDAVecRestoreArray (fft->dc, g, &g_);
+/*
+  Copying between  Vecs  and  the FFTW buffers.  For the batched
+  transforms the m values for the same grid point are adjacent in
+  memory, see many_plans():
+
+    many[k][j][i][s], 0 <= s < m
+
+  A single Vec is the case m = 1.  The real buffer is padded in the
+  (physically) last dimension to 2 (NI / 2 + 1) reals, the complex one
+  has NI / 2 + 1 entries there.  The complex local section  must not
+  be split in that dimension, otherwise we cannot convert between
+  complex and half-complex locally (this is probably also the reason
+  why there is no real to half-complex transforms in FFTW3 MPI).
+
+  Same code in double and single precision.  Vecs are always double,
+  the conversion happens on the way.  PACKING (S, R, FC, Z) defines
+  the functions with the suffix S for the real type R, the FFTW
+  complex type FC and the C complex type Z:
+
+    unpack_real   buf := x[], for forward FFT
+    pack_real     x[] := buf, for inverse FFT
+    pack_cmplx    y[] := buf, for forward FFT
+    unpack_cmplx  buf := y[], for inverse FFT
+*/
+#define PACKING(S, R, FC, Z)                                            \
+  static void unpack_real_many##S (FFT *fft, int m, Vec x[m],           \
+                                   R *restrict many)                    \
+  {                                                                     \
+    int i0, j0, k0, ni, nj, nk, NI, NJ, NK;                             \
+    DMDAGetCorners (fft->da, &i0, &j0, &k0, &ni, &nj, &nk);             \
+    shape (fft, &NI, &NJ, &NK);                                         \
+                                                                        \
+    const int nip = 2 * (NI / 2 + 1);                                   \
+    assert (ni < nip);                                                  \
+                                                                        \
+    R (*const view)[nk][nj][nip][m] = (R (*)[nk][nj][nip][m]) many;     \
+                                                                        \
+    for (int s = 0; s < m; s++)                                         \
+      {                                                                 \
+        double ***x_;                                                   \
+        DMDAVecGetArray (fft->da, x[s], &x_);                           \
+                                                                        \
+        for (int k = 0; k < nk; k++)                                    \
+          for (int j = 0; j < nj; j++)                                  \
+            for (int i = 0; i < ni; i++)                                \
+              (*view)[k][j][i][s] = x_[k0 + k][j0 + j][i0 + i];         \
+                                                                        \
+        DMDAVecRestoreArray (fft->da, x[s], &x_);                       \
+      }                                                                 \
+  }                                                                     \
+                                                                        \
+  static void pack_real_many##S (FFT *fft, int m, Vec x[m],             \
+                                 const R *restrict many)                \
+  {                                                                     \
+    int i0, j0, k0, ni, nj, nk, NI, NJ, NK;                             \
+    DMDAGetCorners (fft->da, &i0, &j0, &k0, &ni, &nj, &nk);             \
+    shape (fft, &NI, &NJ, &NK);                                         \
+                                                                        \
+    const int nip = 2 * (NI / 2 + 1);                                   \
+    assert (ni < nip);                                                  \
+                                                                        \
+    const R (*const view)[nk][nj][nip][m] =                             \
+      (const R (*)[nk][nj][nip][m]) many;                               \
+                                                                        \
+    for (int s = 0; s < m; s++)                                         \
+      {                                                                 \
+        double ***x_;                                                   \
+        DMDAVecGetArray (fft->da, x[s], &x_);                           \
+                                                                        \
+        for (int k = 0; k < nk; k++)                                    \
+          for (int j = 0; j < nj; j++)                                  \
+            for (int i = 0; i < ni; i++)                                \
+              x_[k0 + k][j0 + j][i0 + i] = (*view)[k][j][i][s];         \
+                                                                        \
+        DMDAVecRestoreArray (fft->da, x[s], &x_);                       \
+      }                                                                 \
+  }                                                                     \
+                                                                        \
+  static void pack_cmplx_many##S (FFT *fft, int m, Vec y[m],            \
+                                  /* const */ FC *many)                 \
+  {                                                                     \
+    int i0, j0, k0, ni, nj, nk, NI, NJ, NK;                             \
+    DMDAGetCorners (fft->dc, &i0, &j0, &k0, &ni, &nj, &nk);             \
+    shape (fft, &NI, &NJ, &NK);                                         \
+                                                                        \
+    const int nip = NI / 2 + 1;                                         \
+    assert (ni == nip);                                                 \
+    assert (i0 == 0);                                                   \
+                                                                        \
+    Z (*const view)[nk][nj][nip][m] = (Z (*)[nk][nj][nip][m]) many;     \
+                                                                        \
+    for (int s = 0; s < m; s++)                                         \
+      {                                                                 \
+        complex ***y_;                                                  \
+        DMDAVecGetArray (fft->dc, y[s], &y_);                           \
+                                                                        \
+        for (int k = 0; k < nk; k++)                                    \
+          for (int j = 0; j < nj; j++)                                  \
+            for (int i = 0; i < nip; i++)                               \
+              y_[k0 + k][j0 + j][i0 + i] = (*view)[k][j][i][s];         \
+                                                                        \
+        DMDAVecRestoreArray (fft->dc, y[s], &y_);                       \
+      }                                                                 \
+  }                                                                     \
+                                                                        \
+  static void unpack_cmplx_many##S (FFT *fft, int m, Vec y[m],          \
+                                    FC *many)                           \
+  {                                                                     \
+    int i0, j0, k0, ni, nj, nk, NI, NJ, NK;                             \
+    DMDAGetCorners (fft->dc, &i0, &j0, &k0, &ni, &nj, &nk);             \
+    shape (fft, &NI, &NJ, &NK);                                         \
+                                                                        \
+    const int nip = NI / 2 + 1;                                         \
+    assert (ni == nip);                                                 \
+    assert (i0 == 0);                                                   \
+                                                                        \
+    Z (*const view)[nk][nj][nip][m] = (Z (*)[nk][nj][nip][m]) many;     \
+                                                                        \
+    for (int s = 0; s < m; s++)                                         \
+      {                                                                 \
+        complex ***y_;                                                  \
+        DMDAVecGetArray (fft->dc, y[s], &y_);                           \
+                                                                        \
+        for (int k = 0; k < nk; k++)                                    \
+          for (int j = 0; j < nj; j++)                                  \
+            for (int i = 0; i < nip; i++)                               \
+              (*view)[k][j][i][s] = y_[k0 + k][j0 + j][i0 + i];         \
+                                                                        \
+        DMDAVecRestoreArray (fft->dc, y[s], &y_);                       \
+      }                                                                 \
+  }                                                                     \
+                                                                        \
+  static void unpack_real##S (FFT *fft, Vec g, R *restrict buf)         \
+  {                                                                     \
+    unpack_real_many##S (fft, 1, &g, buf);                              \
+  }                                                                     \
+                                                                        \
+  static void pack_real##S (FFT *fft, Vec g, const R *restrict buf)     \
+  {                                                                     \
+    pack_real_many##S (fft, 1, &g, buf);                                \
+  }                                                                     \
+                                                                        \
+  static void pack_cmplx##S (FFT *fft, Vec g, /* const */ FC *buf)      \
+  {                                                                     \
+    pack_cmplx_many##S (fft, 1, &g, buf);                               \
+  }                                                                     \
+                                                                        \
+  static void unpack_cmplx##S (FFT *fft, Vec g, FC *buf)                \
+  {                                                                     \
+    unpack_cmplx_many##S (fft, 1, &g, buf);                             \
   }
-}
+
+PACKING (, double, fftw_complex, complex)
+PACKING (_single, float, fftwf_complex, float complex)
+#undef PACKING
 
 
 static FFT* context (Mat A)
@@ -225,21 +448,78 @@ static FFT* context (Mat A)
 }
 
 
-/* Does y = A * x. Forward FFT with the interface for use by Petsc: */
+/*
+  The  local  section  of a  complex  Vec  has  exactly the  layout  of
+  FFTW-MPI output,  see pack_cmplx().  FFTW may however use the output
+  array as a  work space  of size alloc_local, and the new-array execute
+  interface requires  the same alignment  as the one  used  in planning.
+  Check if the storage of Vec y satisfies both conditions:
+*/
+static bool zero_copy (const FFT *fft, Vec y, PetscScalar *y_)
+{
+  int n;
+  VecGetLocalSize (y, &n);
+
+  return (n == 2 * fft->alloc_local &&
+          fftw_alignment_of (y_) == fftw_alignment_of (fft->doubl));
+}
+
+
+/*
+  Does y = A * x. Forward FFT with the interface for use by Petsc.  The
+  transform writes directly into the storage  of Vec y whenever that is
+  possible and falls back to a scratch array otherwise.
+*/
 static PetscErrorCode mat_mult_fft (Mat A, Vec x, Vec y)
 {
   /* Only  matrices  constructed   by  mat_create_fft()  are  accepted
      here: */
   FFT *fft = context (A);
 
+  if (fft->pencil)
+    {
+      bgy3d_pencil_forward (fft->pencil, x, y);
+      return 0;
+    }
+
+  if (fft->single)
+    {
+      unpack_real_single (fft, x, fft->floats);
+
+      /* in-place forward fft */
+      fftwf_execute (fft->fw_single);
+
+      pack_cmplx_single (fft, y, (fftwf_complex*) fft->floats);
+      return 0;
+    }
+
   /* Fill real array with real data from x: */
   unpack_real (fft, x, fft->doubl);
 
-  /* forward fft */
-  fftw_execute (fft->fw);
+  PetscScalar *y_;
+  VecGetArray (y, &y_);
 
-  /* Pack complex output into complex Vec y: */
-  pack_cmplx (fft, y, fft->cmplx);
+  if (zero_copy (fft, y, y_))
+    {
+      /* forward fft, output directly into y: */
+      fftw_mpi_execute_dft_r2c (fft->fw, fft->doubl, (fftw_complex*) y_);
+
+      VecRestoreArray (y, &y_);
+    }
+  else
+    {
+      VecRestoreArray (y, &y_);
+
+      /* Aligned by fftw_alloc_complex(), as in planning: */
+      if (fft->cmplx == NULL)
+        fft->cmplx = fftw_alloc_complex (fft->alloc_local);
+
+      /* forward fft */
+      fftw_mpi_execute_dft_r2c (fft->fw, fft->doubl, fft->cmplx);
+
+      /* Pack complex output into complex Vec y: */
+      pack_cmplx (fft, y, fft->cmplx);
+    }
 
   return 0;
 }
@@ -252,8 +532,29 @@ static PetscErrorCode mat_mult_transpose_fft (Mat A, Vec x, Vec y)
      here: */
   FFT *fft = context (A);
 
-  /* Fill complex array with halfcomplex data from x: */
-  unpack_cmplx (fft, x, fft->cmplx);
+  if (fft->pencil)
+    {
+      bgy3d_pencil_backward (fft->pencil, x, y);
+      return 0;
+    }
+
+  if (fft->single)
+    {
+      unpack_cmplx_single (fft, x, (fftwf_complex*) fft->floats);
+
+      /* in-place inverse fft */
+      fftwf_execute (fft->bw_single);
+
+      pack_real_single (fft, y, fft->floats);
+      return 0;
+    }
+
+  /*
+    Fill complex array with halfcomplex data from x. This copy cannot
+    be avoided as c2r transforms destroy their input. The transform is
+    in-place, so the complex view shares storage with the real one:
+  */
+  unpack_cmplx (fft, x, (fftw_complex*) fft->doubl);
 
   /* inverse fft */
   fftw_execute (fft->bw);
@@ -281,11 +582,37 @@ static PetscErrorCode mat_destroy_fft (Mat A)
   DMDestroy (&fft->da);
   DMDestroy (&fft->dc);
 
-  fftw_destroy_plan (fft->fw);
-  fftw_destroy_plan (fft->bw);
+  if (fft->pencil)
+    bgy3d_pencil_destroy (fft->pencil);
+  else
+    {
+      fftw_destroy_plan (fft->fw);
+      fftw_destroy_plan (fft->bw);
+    }
+
+  fftw_free (fft->doubl);       /* maybe NULL */
+  fftw_free (fft->cmplx);       /* maybe NULL */
+
+  if (fft->floats)
+    {
+      fftwf_destroy_plan (fft->fw_single);
+      fftwf_destroy_plan (fft->bw_single);
+      fftwf_free (fft->floats);
+    }
 
-  fftw_free (fft->doubl);
-  fftw_free (fft->cmplx);
+  for (int i = 0; i < fft->n_many; i++)
+    {
+      fftw_destroy_plan (fft->many_plan[i].fw);
+      fftw_destroy_plan (fft->many_plan[i].bw);
+    }
+  fftw_free (fft->many);        /* maybe NULL */
+
+  for (int i = 0; i < fft->n_many_single; i++)
+    {
+      fftwf_destroy_plan (fft->many_plan_single[i].fw);
+      fftwf_destroy_plan (fft->many_plan_single[i].bw);
+    }
+  fftwf_free (fft->many_single); /* maybe NULL */
   free (fft);
 
   return 0;
@@ -337,53 +664,124 @@ static PetscErrorCode mat_destroy_fft (Mat A)
   2  * (N/2 +  1).  The  corresponding complex  arrays will  have NP/2
   elements which is the main reason for the padding, actually.
 */
-static int fftw_mpi_init_called = 0;
 void bgy3d_fft_mat_create (const int N[3], Mat *A, DA *da, DA *dc)
 {
-  /* FIXME: find a better place: */
-  if (!fftw_mpi_init_called)
-    {
-      fftw_mpi_init ();          /* required */
-      atexit (fftw_mpi_cleanup); /* required */
-      fftw_mpi_init_called = 1;
-    }
+  /* Collective, all workers of comm_world_petsc are here: */
+  fft_init (true);
 
   /* Allocates storage for an FFT struct: */
   FFT *fft = malloc (sizeof *fft);
 
+  /* No batched plans yet, see many_plans(): */
+  fft->n_many = fft->next_many = 0;
+  fft->many = NULL;
+  fft->many_size = 0;
+  fft->n_many_single = fft->next_many_single = 0;
+  fft->many_single = NULL;
+  fft->many_size_single = 0;
+
+  /* Double precision by default, see bgy3d_fft_mat_single(): */
+  fft->single = false;
+  fft->floats = NULL;
+
   /* Get number of processes */
   int np, id;
   MPI_Comm_size (comm_world_petsc, &np);
   MPI_Comm_rank (comm_world_petsc, &id);
 
+  /*
+    The slab decomposition along N[2] limits the number of workers to
+    N[2]. With --fft-pencil p1 the workers are arranged in a p1 x (np /
+    p1)  grid over  N[1] and N[2] instead, see bgy3d-pencil.c.  Zero
+    means slabs:
+  */
+  int p1 = 0;
+  bgy3d_getopt_int ("fft-pencil", &p1);
+
+  /*
+    Most  of the  work  in  k-space is  local  to  each  grid  point.
+    Keeping the forward  transform output transposed saves  one out of
+    the two all-to-all exchanges in each direction. Slabs only:
+  */
+  fft->transposed = (p1 == 0) && bgy3d_getopt_test ("fft-transposed");
+
+  fft->pencil = NULL;
+  if (p1 > 0)
+    {
+      fft->pencil = bgy3d_pencil_create (N, p1, planner, &fft->da, &fft->dc);
+      fft->doubl = NULL;
+      fft->cmplx = NULL;
+      fft->alloc_local = 0;
+    }
+  else
   /* FIXME: see bgy3d_fft_init_da () and avoid code duplication: */
   {
     ptrdiff_t alloc_local, local_range, local_start;
 
+    /*
+      Local  range of  N[1] in  the  transposed  k-space  layout.  The
+      real-space distribution along N[2] is the same in both cases:
+    */
+    ptrdiff_t local_range_t, local_start_t;
+
     /* get local data size and allocate */
-    alloc_local = fftw_mpi_local_size_3d (N[2], N[1], N[0] / 2 + 1,
-                                          comm_world_petsc,
-                                          &local_range,
-                                          &local_start);
+    if (fft->transposed)
+      alloc_local = fftw_mpi_local_size_3d_transposed (N[2], N[1], N[0] / 2 + 1,
+                                                       comm_world_petsc,
+                                                       &local_range,
+                                                       &local_start,
+                                                       &local_range_t,
+                                                       &local_start_t);
+    else
+      alloc_local = fftw_mpi_local_size_3d (N[2], N[1], N[0] / 2 + 1,
+                                            comm_world_petsc,
+                                            &local_range,
+                                            &local_start);
+
+    const unsigned layout =
+      fft->transposed ? FFTW_MPI_TRANSPOSED_OUT : 0;
 
-    /* Scratch arrays for FFT: */
+    /*
+      Scratch array for  FFT.  The forward transform  writes directly
+      into the  complex Vec, if possible, see mat_mult_fft().  The
+      inverse transform is done in-place:
+    */
+    fft->alloc_local = alloc_local;
     fft->doubl = fftw_alloc_real (2 * alloc_local);
-    fft->cmplx = fftw_alloc_complex (alloc_local);
+    fft->cmplx = NULL;
 
-    /* create plan for out-of-place forward DFT */
-    fft->fw = fftw_mpi_plan_dft_r2c_3d (N[2], N[1], N[0],
-                                        fft->doubl, fft->cmplx,
-                                        comm_world_petsc,
-                                        FFTW_ESTIMATE);
+    /*
+      Create plan for out-of-place forward  DFT.  The output array is
+      only  used for planning, the  plan  is executed  with  the  new
+      array  interface.  The input is a scratch array and may be
+      destroyed:
+    */
+    {
+      fftw_complex *cmplx = fftw_alloc_complex (alloc_local);
+
+      fft->fw = fftw_mpi_plan_dft_r2c_3d (N[2], N[1], N[0],
+                                          fft->doubl, cmplx,
+                                          comm_world_petsc,
+                                          planner | FFTW_DESTROY_INPUT | layout);
+      fftw_free (cmplx);
+    }
     assert (fft->fw != NULL);
 
-    /* create plan for out-of-place inverse DFT */
+    /*
+      Create plan for  in-place inverse DFT.  It accepts  the k-space
+      layout the forward one produces:
+    */
     fft->bw = fftw_mpi_plan_dft_c2r_3d (N[2], N[1], N[0],
-                                        fft->cmplx, fft->doubl,
+                                        (fftw_complex*) fft->doubl,
+                                        fft->doubl,
                                         comm_world_petsc,
-                                        FFTW_ESTIMATE);
+                                        planner | (fft->transposed ?
+                                                   FFTW_MPI_TRANSPOSED_IN : 0));
     assert (fft->bw != NULL);
 
+    /* Make the new plans persistent, if asked to: */
+    wisdom_save ();
+
     /*
       Create  Petsc  Distributed  Array  according  to  FFTW-MPI  data
       distribution. The  FFTW MPI distributes the  work/data among the
@@ -428,13 +826,40 @@ void bgy3d_fft_mat_create (const int N[3], Mat *A, DA *da, DA *dc)
     */
     int l0half[1] = {N[0] / 2 + 1};
 
-    fft->dc = da_create (2, 1, l0half, 1, l1, np, l2);
+    if (!fft->transposed)
+      fft->dc = da_create (2, 1, l0half, 1, l1, np, l2);
+    else
+      {
+        /*
+          The k-space array is  N[1] x N[2] x (N[0] / 2 + 1) in C-order,
+          distributed along N[1]. For Petsc  the dimensions 1 and 2 are
+          swapped. Same as above, Petsc refuses zero ranges, so that
+          the number of workers is limited by N[1] too:
+        */
+        int l2t[1] = {N[2]}, l1t[np]; /* sum (l1t[:]) == N[1] */
+
+        int local_range_ = local_range_t; /* cast to int */
+        int err = MPI_Allgather (&local_range_, 1, MPI_INT, l1t, 1,
+                                 MPI_INT, comm_world_petsc);
+        assert (err == MPI_SUCCESS);
+
+        fft->dc = da_create (2, 1, l0half, 1, l2t, np, l1t);
+
+        if (transposed_tag < 0)
+          PetscObjectComposedDataRegister (&transposed_tag);
+
+        PetscObjectComposedDataSetInt ((PetscObject) fft->dc, transposed_tag, 1);
+      }
   }
 
   /* Get local dimensions: */
   int x[3], n[3];
   DMDAGetCorners (fft->da, &x[0], &x[1], &x[2], &n[0], &n[1], &n[2]);
 
+  /* Local size of k-space section may differ when transposed: */
+  int xc[3], nc[3];
+  DMDAGetCorners (fft->dc, &xc[0], &xc[1], &xc[2], &nc[0], &nc[1], &nc[2]);
+
   if (debug)
     {
       for (int i = 0; i < 3; i++)
@@ -456,7 +881,7 @@ void bgy3d_fft_mat_create (const int N[3], Mat *A, DA *da, DA *dc)
     const int M0 = N[2] * N[1] * (N[0] / 2 + 1) * 2;
     const int M1 = N[2] * N[1] * N[0];
 
-    const int m0 = n[2] * n[1] * (n[0] / 2 + 1) * 2;
+    const int m0 = nc[2] * nc[1] * nc[0] * 2;
     const int m1 = n[2] * n[1] * n[0];
 
     if (debug)
@@ -490,6 +915,350 @@ void bgy3d_fft_mat_create (const int N[3], Mat *A, DA *da, DA *dc)
 }
 
 
+/*
+  Switch the  transforms to single precision and  back. Vecs stay in
+  double precision,  only the FFTs  including  the all-to-all exchanges
+  operate on floats then. Cheaper by  about a factor of two, this is
+  good enough for early iterations that are far from convergence. The
+  plans  are made  on the  first use.  Collective.  Pencils  have no
+  single precision transforms, the flag is ignored with them.
+*/
+void bgy3d_fft_mat_single (Mat A, bool single)
+{
+  FFT *fft = context (A);
+
+  if (fft->pencil)
+    return;
+
+  fft->single = single;
+
+  if (!single || fft->floats)
+    return;
+
+  int N[3];
+  shape (fft, &N[0], &N[1], &N[2]);
+
+  /* Same distribution as in bgy3d_fft_mat_create(): */
+  ptrdiff_t alloc_local, local_range, local_start;
+  if (fft->transposed)
+    {
+      ptrdiff_t local_range_t, local_start_t;
+      alloc_local =
+        fftwf_mpi_local_size_3d_transposed (N[2], N[1], N[0] / 2 + 1,
+                                            comm_world_petsc,
+                                            &local_range, &local_start,
+                                            &local_range_t, &local_start_t);
+    }
+  else
+    alloc_local = fftwf_mpi_local_size_3d (N[2], N[1], N[0] / 2 + 1,
+                                           comm_world_petsc,
+                                           &local_range, &local_start);
+
+  /* Complex numbers take the space of two reals: */
+  fft->floats = fftwf_alloc_real (2 * alloc_local);
+
+  fft->fw_single =
+    fftwf_mpi_plan_dft_r2c_3d (N[2], N[1], N[0],
+                               fft->floats, (fftwf_complex*) fft->floats,
+                               comm_world_petsc,
+                               planner | (fft->transposed ?
+                                          FFTW_MPI_TRANSPOSED_OUT : 0));
+  assert (fft->fw_single != NULL);
+
+  fft->bw_single =
+    fftwf_mpi_plan_dft_c2r_3d (N[2], N[1], N[0],
+                               (fftwf_complex*) fft->floats, fft->floats,
+                               comm_world_petsc,
+                               planner | (fft->transposed ?
+                                          FFTW_MPI_TRANSPOSED_IN : 0));
+  assert (fft->bw_single != NULL);
+}
+
+
+/*
+  Batched transforms. Many  quantities in this code come  in groups of
+  m, one Vec for  each solvent site.  Transforming them one  by one as
+  MatMult() does  costs m  all-to-all exchanges  of the  distributed
+  transpose inside FFTW-MPI, each with  m times smaller messages than
+  necessary.  With  "howmany" set to  m FFTW  does the m  transforms in
+  one go. The price is that the data needs to be interleaved, so that
+  the m values for the same grid point are adjacent in memory:
+
+    many[k][j][i][s], 0 <= s < m
+
+  Plans  are  in-place  to  not  allocate  two buffers  of  size  m  x
+  N^3.  FFTW_MPI_DEFAULT_BLOCK  leads  to the same  distribution of the
+  leading dimension as in bgy3d_fft_mat_create() so that the DA array
+  descriptors apply as they are.
+*/
+/*
+  Local size in complex numbers and the layout flags of the batched
+  transforms.  Checks that the distribution is that of the DA array
+  descriptors:
+*/
+static ptrdiff_t many_layout (FFT *fft, int m,
+                              unsigned *fw_layout, unsigned *bw_layout)
+{
+  int N[3];
+  shape (fft, &N[0], &N[1], &N[2]);
+
+  /* Note the reversed order, see comments to bgy3d_fft_mat_create(): */
+  const ptrdiff_t nc[3] = {N[2], N[1], N[0] / 2 + 1};
+
+  ptrdiff_t local_range, local_start, alloc_local;
+
+  *fw_layout = 0;
+  *bw_layout = 0;
+
+  if (!fft->transposed)
+    alloc_local =
+      fftw_mpi_local_size_many (3, nc, m, FFTW_MPI_DEFAULT_BLOCK,
+                                comm_world_petsc,
+                                &local_range, &local_start);
+  else
+    {
+      /* The k-space layout [j][k][i], see bgy3d_fft_mat_create(): */
+      ptrdiff_t local_range_t, local_start_t;
+      alloc_local =
+        fftw_mpi_local_size_many_transposed (3, nc, m,
+                                             FFTW_MPI_DEFAULT_BLOCK,
+                                             FFTW_MPI_DEFAULT_BLOCK,
+                                             comm_world_petsc,
+                                             &local_range, &local_start,
+                                             &local_range_t, &local_start_t);
+
+      int i0, j0, k0, ni, nj, nk;
+      DMDAGetCorners (fft->dc, &i0, &j0, &k0, &ni, &nj, &nk);
+      assert (nk == local_range_t);
+      assert (k0 == local_start_t);
+
+      *fw_layout = FFTW_MPI_TRANSPOSED_OUT;
+      *bw_layout = FFTW_MPI_TRANSPOSED_IN;
+    }
+
+  /* Same distribution as for the array descriptors: */
+  {
+    int i0, j0, k0, ni, nj, nk;
+    DMDAGetCorners (fft->da, &i0, &j0, &k0, &ni, &nj, &nk);
+    assert (nk == local_range);
+    assert (k0 == local_start);
+  }
+
+  return alloc_local;
+}
+
+
+/*
+  Returns the  index of the batched  plans for m transforms, making
+  them if not yet there.  The buffer is grown first, so that the
+  plans are made on the storage they are executed on.  Older plans
+  are executed on the  new buffer by the new-array interface, FFTW
+  aligns  all buffers the same way.  Collective:
+*/
+static int many_plans (FFT *fft, int m)
+{
+  for (int i = 0; i < fft->n_many; i++)
+    if (fft->many_plan[i].m == m)
+      return i;
+
+  int N[3];
+  shape (fft, &N[0], &N[1], &N[2]);
+
+  /* Note the reversed order, see comments to bgy3d_fft_mat_create(): */
+  const ptrdiff_t nr[3] = {N[2], N[1], N[0]};
+
+  unsigned fw_layout, bw_layout;
+  const ptrdiff_t alloc_local = many_layout (fft, m, &fw_layout, &bw_layout);
+
+  /* Complex numbers take the space of two reals: */
+  if (alloc_local > fft->many_size)
+    {
+      fftw_free (fft->many);
+      fft->many = fftw_alloc_real (2 * alloc_local);
+      fft->many_size = alloc_local;
+    }
+
+  /* Free slot, or the oldest one: */
+  const int i = fft->next_many;
+  if (fft->n_many < MAX_MANY)
+    fft->n_many++;
+  else
+    {
+      fftw_destroy_plan (fft->many_plan[i].fw);
+      fftw_destroy_plan (fft->many_plan[i].bw);
+    }
+  fft->next_many = (i + 1) % MAX_MANY;
+
+  double *doubl = fft->many;
+  fftw_complex *cmplx = (fftw_complex*) fft->many;
+
+  fft->many_plan[i].m = m;
+  fft->many_plan[i].fw = fftw_mpi_plan_many_dft_r2c (3, nr, m,
+                                                     FFTW_MPI_DEFAULT_BLOCK,
+                                                     FFTW_MPI_DEFAULT_BLOCK,
+                                                     doubl, cmplx,
+                                                     comm_world_petsc,
+                                                     planner | fw_layout);
+  assert (fft->many_plan[i].fw != NULL);
+
+  fft->many_plan[i].bw = fftw_mpi_plan_many_dft_c2r (3, nr, m,
+                                                     FFTW_MPI_DEFAULT_BLOCK,
+                                                     FFTW_MPI_DEFAULT_BLOCK,
+                                                     cmplx, doubl,
+                                                     comm_world_petsc,
+                                                     planner | bw_layout);
+  assert (fft->many_plan[i].bw != NULL);
+
+  /* Callers of many_plans() are collective: */
+  wisdom_save ();
+
+  return i;
+}
+
+
+/*
+  Single precision counterpart of  many_plans(), same layout of the
+  buffer with floats in place of doubles:
+*/
+static int many_plans_single (FFT *fft, int m)
+{
+  for (int i = 0; i < fft->n_many_single; i++)
+    if (fft->many_plan_single[i].m == m)
+      return i;
+
+  int N[3];
+  shape (fft, &N[0], &N[1], &N[2]);
+
+  const ptrdiff_t nr[3] = {N[2], N[1], N[0]};
+
+  /* The distribution does not depend on the precision: */
+  unsigned fw_layout, bw_layout;
+  const ptrdiff_t alloc_local = many_layout (fft, m, &fw_layout, &bw_layout);
+
+  if (alloc_local > fft->many_size_single)
+    {
+      fftwf_free (fft->many_single);
+      fft->many_single = fftwf_alloc_real (2 * alloc_local);
+      fft->many_size_single = alloc_local;
+    }
+
+  const int i = fft->next_many_single;
+  if (fft->n_many_single < MAX_MANY)
+    fft->n_many_single++;
+  else
+    {
+      fftwf_destroy_plan (fft->many_plan_single[i].fw);
+      fftwf_destroy_plan (fft->many_plan_single[i].bw);
+    }
+  fft->next_many_single = (i + 1) % MAX_MANY;
+
+  float *floats = fft->many_single;
+  fftwf_complex *cmplx = (fftwf_complex*) fft->many_single;
+
+  fft->many_plan_single[i].m = m;
+  fft->many_plan_single[i].fw =
+    fftwf_mpi_plan_many_dft_r2c (3, nr, m,
+                                 FFTW_MPI_DEFAULT_BLOCK,
+                                 FFTW_MPI_DEFAULT_BLOCK,
+                                 floats, cmplx,
+                                 comm_world_petsc,
+                                 planner | fw_layout);
+  assert (fft->many_plan_single[i].fw != NULL);
+
+  fft->many_plan_single[i].bw =
+    fftwf_mpi_plan_many_dft_c2r (3, nr, m,
+                                 FFTW_MPI_DEFAULT_BLOCK,
+                                 FFTW_MPI_DEFAULT_BLOCK,
+                                 cmplx, floats,
+                                 comm_world_petsc,
+                                 planner | bw_layout);
+  assert (fft->many_plan_single[i].bw != NULL);
+
+  return i;
+}
+
+
+/*
+  Does y[s] = A * x[s] for s = 0, ..., m - 1.  The result is the same
+  as of m  calls to MatMult (A,  x[s], y[s]).  The Vecs  may  as well be
+  aliases of the sections of a long Vec, see vec_aliases_create1():
+*/
+void bgy3d_fft_mat_mult_many (Mat A, int m, Vec x[m], Vec y[m])
+{
+  FFT *fft = context (A);
+
+  /* No batched transforms with pencils yet: */
+  if (fft->pencil)
+    {
+      for (int s = 0; s < m; s++)
+        MatMult (A, x[s], y[s]);
+      return;
+    }
+
+  if (fft->single)
+    {
+      const int i = many_plans_single (fft, m);
+      float *floats = fft->many_single;
+
+      unpack_real_many_single (fft, m, x, floats);
+
+      fftwf_mpi_execute_dft_r2c (fft->many_plan_single[i].fw,
+                                 floats, (fftwf_complex*) floats);
+
+      pack_cmplx_many_single (fft, m, y, (fftwf_complex*) floats);
+      return;
+    }
+
+  const int i = many_plans (fft, m);
+  double *doubl = fft->many;
+
+  unpack_real_many (fft, m, x, doubl);
+
+  fftw_mpi_execute_dft_r2c (fft->many_plan[i].fw,
+                            doubl, (fftw_complex*) doubl);
+
+  pack_cmplx_many (fft, m, y, (fftw_complex*) doubl);
+}
+
+
+/* Does y[s] = A^T * x[s], the inverse FFT, for s = 0, ..., m - 1: */
+void bgy3d_fft_mat_mult_transpose_many (Mat A, int m, Vec x[m], Vec y[m])
+{
+  FFT *fft = context (A);
+
+  if (fft->pencil)
+    {
+      for (int s = 0; s < m; s++)
+        MatMultTranspose (A, x[s], y[s]);
+      return;
+    }
+
+  if (fft->single)
+    {
+      const int i = many_plans_single (fft, m);
+      float *floats = fft->many_single;
+
+      unpack_cmplx_many_single (fft, m, x, (fftwf_complex*) floats);
+
+      fftwf_mpi_execute_dft_c2r (fft->many_plan_single[i].bw,
+                                 (fftwf_complex*) floats, floats);
+
+      pack_real_many_single (fft, m, y, floats);
+      return;
+    }
+
+  const int i = many_plans (fft, m);
+  double *doubl = fft->many;
+
+  unpack_cmplx_many (fft, m, x, (fftw_complex*) doubl);
+
+  fftw_mpi_execute_dft_c2r (fft->many_plan[i].bw,
+                            (fftw_complex*) doubl, doubl);
+
+  pack_real_many (fft, m, y, doubl);
+}
+
+
 /*
   Given the FFT transform Vec  Y of some equally-spaced grid sample of
   a real-valued function y(x), compute the values of y(x) at arbitrary
@@ -518,8 +1287,20 @@ void bgy3d_fft_interp (const Mat A,
     y[p] = 0.0;
 
   /* loop over local portion of grid */
-  int c[3], n[3];             /* corner and the size of the section */
-  DMDAGetCorners (fft->dc, &c[0], &c[1], &c[2], &n[0], &n[1], &n[2]);
+  int c_[3], n_[3];           /* corner and the size of the section */
+  DMDAGetCorners (fft->dc, &c_[0], &c_[1], &c_[2], &n_[0], &n_[1], &n_[2]);
+
+  /*
+    Same in  the order of  the real grid  dimensions.  Differs  from the
+    above for the transposed k-space layout:
+  */
+  int kdim[3], c[3], n[3];
+  kspace_dims (fft->dc, kdim);
+  FOR_DIM
+    {
+      c[dim] = c_[kdim[dim]];
+      n[dim] = n_[kdim[dim]];
+    }
 
   /*
     Precompute tables for sin/cos or, rather, cexp(). Each worker owns
@@ -563,18 +1344,21 @@ void bgy3d_fft_interp (const Mat A,
   complex ***Y_;
   DMDAVecGetArray (fft->dc, Y, &Y_);
 
-  int k[3];
-  for (k[2] = c[2]; k[2] < c[2] + n[2]; k[2]++)
-    for (k[1] = c[1]; k[1] < c[1] + n[1]; k[1]++)
-      for (k[0] = c[0]; k[0] < c[0] + n[0]; k[0]++)
+  int k_[3];
+  for (k_[2] = c_[2]; k_[2] < c_[2] + n_[2]; k_[2]++)
+    for (k_[1] = c_[1]; k_[1] < c_[1] + n_[1]; k_[1]++)
+      for (k_[0] = c_[0]; k_[0] < c_[0] + n_[0]; k_[0]++)
         {
           /* Take negative frequencies where k > N/2: */
-          int K[3];
+          int k[3], K[3];
           FOR_DIM
-            K[dim] = KFREQ (k[dim], N[dim]);
+            {
+              k[dim] = k_[kdim[dim]];
+              K[dim] = KFREQ (k[dim], N[dim]);
+            }
 
           /* Note the sequence, 2, 1, 0: */
-          const complex yk = Y_[k[2]][k[1]][k[0]];
+          const complex yk = Y_[k_[2]][k_[1]][k_[0]];
 
           for (int p = 0; p < np; p++)
             {
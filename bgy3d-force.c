@@ -50,8 +50,9 @@ static void grad_fft (const State *BHD, Vec uc_fft, Vec fc_fft[3])
     dk[dim] = 2 * M_PI / PD->L[dim];
 
   /* Get local portion of the k-grid */
-  int x[3], n[3], i[3];
+  int x[3], n[3], i[3], kdim[3];
   DMDAGetCorners (BHD->dc, &x[0], &x[1], &x[2], &n[0], &n[1], &n[2]);
+  kspace_dims (BHD->dc, kdim);
 
   complex ***uc_fft_, ***fc_fft_[3];
   DMDAVecGetArray (BHD->dc, uc_fft, &uc_fft_);
@@ -67,7 +68,7 @@ static void grad_fft (const State *BHD, Vec uc_fft, Vec fc_fft[3])
 
           /* Take negative frequencies for i > N/2: */
           FOR_DIM
-            k[dim] = KFREQ (i[dim], N[dim]) * dk[dim];
+            k[dim] = KFREQ (i[kdim[dim]], N[dim]) * dk[dim];
 
           /* Force  is purely imaginary  if Vec  uc_fft happens  to be
              real: */
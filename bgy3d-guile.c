@@ -12,8 +12,10 @@
 #include "bgy3d-solutes.h"      /* struct Site */
 #include "bgy3d-solvents.h"     /* bgy3d_solvent_get() */
 #include "bgy3d-pure.h"
+#include "bgy3d-radial.h"       /* bgy3d_solvent_solve_radial() */
 #include "bgy3d-potential.h"    /* Context */
 #include "bgy3d-impure.h"       /* bgy3d_solve_with_solute */
+#include "bgy3d-restart.h"      /* bgy3d_restart_load() */
 #include "hnc3d.h"              /* hnc3d_solute_solve() */
 #include "bgy3d-vec.h"          /* bgy3d_vec_save, bgy3d_vec_load */
 #include "bgy3d-fft.h"          /* bgy3d_fft_test() */
@@ -24,6 +26,7 @@
 #include "eos.h"                /* eos_alj(), etc. */
 #include "lebed/lebed.h"        /* genpts() */
 #include "bgy3d-guile.h"
+#include <limits.h>             /* PATH_MAX */
 
 #ifdef WITH_FFTW_THREADS
 #include <fftw3.h>              /* fftw_init_threads(), fftw_cleanup_threads */
@@ -163,8 +166,8 @@ lookup (const char *module, const char *name)
 
 
 /* Lookup dynvar: */
-static SCM
-guile_get_settings ()
+SCM
+guile_get_settings (void)
 {
   return scm_fluid_ref (lookup ("guile bgy3d", "*settings*"));
 }
@@ -780,12 +783,19 @@ static SCM guile_vec_map1 (SCM f, SCM x)
   Vec x_ = to_vec (x);
   Vec y_ = vec_duplicate (x_);
 
-  void f_ (int n, double x[n], double y[n])
-  {
-    for (int i = 0; i < n; i++)
-      y[i] = scm_to_double (scm_call_1 (f, scm_from_double (x[i])));
-  }
-  vec_app2 (f_, x_, y_);
+  /*
+    Not  vec_app2() as  that may  run several  threads, and  Guile  is
+    not to be entered from those:
+  */
+  const int n = vec_local_size (x_);
+  local real *x = vec_get_array (x_);
+  local real *y = vec_get_array (y_);
+
+  for (int i = 0; i < n; i++)
+    y[i] = scm_to_double (scm_call_1 (f, scm_from_double (x[i])));
+
+  vec_restore_array (x_, &x);
+  vec_restore_array (y_, &y);
 
   return from_vec (y_);
 }
@@ -797,13 +807,20 @@ static SCM guile_vec_map2 (SCM f, SCM x, SCM y)
   Vec y_ = to_vec (y);
   Vec z_ = vec_duplicate (x_);
 
-  void f_ (int n, double x[n], double y[n], double z[n])
-  {
-    for (int i = 0; i < n; i++)
-      z[i] = scm_to_double
-        (scm_call_2 (f, scm_from_double (x[i]), scm_from_double (y[i])));
-  }
-  vec_app3 (f_, x_, y_, z_);
+  /* Serial, see guile_vec_map1(): */
+  const int n = vec_local_size (x_);
+  assert (vec_local_size (y_) == n);
+  local real *x = vec_get_array (x_);
+  local real *y = vec_get_array (y_);
+  local real *z = vec_get_array (z_);
+
+  for (int i = 0; i < n; i++)
+    z[i] = scm_to_double
+      (scm_call_2 (f, scm_from_double (x[i]), scm_from_double (y[i])));
+
+  vec_restore_array (x_, &x);
+  vec_restore_array (y_, &y);
+  vec_restore_array (z_, &z);
 
   return from_vec (z_);
 }
@@ -1021,6 +1038,89 @@ static void guile_init_vec_type (void)
 typedef
 void (*SV) (const ProblemData *PD, int m, const Site solvent[m], Vec g[m][m]);
 
+/*
+  Grid sequencing.  Converge on the coarser grids N / 2^l with l =
+  levels - 1, ..., 1 first,  each  time starting from the  previous
+  solution interpolated  spectrally to the next finer grid. Returns the
+  restart info for the  grid N  or NULL if --grid-levels is not above
+  one.  The coarse grids need grid independent solvent input.
+*/
+static Restart*
+coarse_guess (SU solute_solve, const ProblemData *PD,
+              int m, const Site solvent[m],
+              int n, const Site solute[n],
+              void (*density)(int k, const real x[k][3], real rho[k]),
+              const real *chi_fft_buf)
+{
+  int levels = 1;
+  bgy3d_getopt_int ("grid-levels", &levels);
+
+  if (levels > 1 &&
+      (bgy3d_getopt_test ("solvent-3d") ||
+       (solute_solve == bgy3d_solute_solve &&
+        !bgy3d_getopt_test ("from-radial-g2"))))
+    {
+      PRINTF ("Grid sequencing needs radial solvent input, ignoring --grid-levels\n");
+      levels = 1;
+    }
+
+  /*
+    Each worker needs at least one plane of the coarsest grid in the
+    decomposed dimensions, see bgy3d_fft_mat_create(). These are N[2]
+    for slabs, also N[1] for the transposed k-space layout, and both
+    for the p1 x (np / p1) pencils:
+  */
+  int need[3] = {1, 1, comm_size ()};
+  {
+    int p1 = 0;
+    bgy3d_getopt_int ("fft-pencil", &p1);
+    if (p1 > 0)
+      {
+        need[1] = p1;
+        need[2] = need[2] / p1;
+      }
+    else if (bgy3d_getopt_test ("fft-transposed"))
+      need[1] = need[2];
+  }
+
+  /* Each level halves the grid, stop at what divides N and is wide
+     enough: */
+  for (; levels > 1; levels--)
+    {
+      const int f = 1 << (levels - 1);
+      bool ok = true;
+      FOR_DIM
+        ok = ok && (PD->N[dim] % f == 0) && (PD->N[dim] / f >= need[dim]);
+      if (ok)
+        break;
+    }
+
+  Restart *guess = NULL;
+  for (int l = levels - 1; l > 0; l--)
+    {
+      ProblemData pd = *PD;     /* modify a copy, not the original */
+      FOR_DIM
+        {
+          pd.N[dim] = PD->N[dim] >> l;
+          pd.h[dim] = pd.L[dim] / pd.N[dim];
+        }
+
+      PRINTF ("(grid sequencing, %d x %d x %d)\n", pd.N[0], pd.N[1], pd.N[2]);
+
+      /* Only the restart info is of interest here: */
+      SCM dict = SCM_EOL;
+      Vec g[m];
+      solute_solve (&pd, m, solvent, n, solute, density,
+                    &dict, g, chi_fft_buf, NULL, &guess);
+      vec_destroy1 (m, g);
+
+      guess = bgy3d_restart_prolong (pd.N, m, guess);
+    }
+
+  return guess;
+}
+
+
 /* Decode SCM input,  encode output to SCM. The  first argument is the
    actual solver that operates with C-types. */
 static SCM
@@ -1061,7 +1161,11 @@ run_solvent (SV solve_solvent, SCM solvent)
 static SCM
 guile_bgy3d_solvent (SCM solvent)
 {
-  return run_solvent (bgy3d_solve_solvent, solvent);
+  /* The radial solver is equivalent and much cheaper: */
+  if (bgy3d_getopt_test ("radial-solvent"))
+    return run_solvent (bgy3d_solvent_solve_radial, solvent);
+  else
+    return run_solvent (bgy3d_solve_solvent, solvent);
 }
 
 
@@ -1175,6 +1279,58 @@ run_solute (SU solute_solve, SCM solute, SCM solvent,
   else
     pass = NULL;                /* dont have, dont want anything */
 
+  /*
+    With --restart-store  DIR the converged result is kept on disk and
+    the result for the nearest geometry stored there is the initial
+    guess. The two solvers do not share restart info:
+  */
+  char store[PATH_MAX] = "";
+  bgy3d_getopt_string ("restart-store", sizeof store, store);
+  const char *method = (solute_solve == bgy3d_solute_solve ? "bgy" : "hnc");
+
+  /*
+    With --restart-extrapolate p the results for the last p + 1 points
+    along a scan predict the initial guess. This is  better than the
+    restart info of the last point, so the latter is then dropped:
+  */
+  int order = 0;
+  bgy3d_getopt_int ("restart-extrapolate", &order);
+
+  Restart *guess = NULL;
+  if (order > 0)
+    guess = bgy3d_restart_predict (order, method, &PD, m, solvent_sites,
+                                   n, solute_sites);
+
+  if (guess && pass && restart_)
+    {
+      bgy3d_restart_destroy (restart_);
+      restart_ = NULL;
+    }
+
+  /*
+    Without  restart info  from the  caller the  initial guess  may come
+    from the store or from the  coarser grids.  If the caller did not
+    ask for restart info the one returned by the solver is discarded:
+  */
+  if (!(pass && restart_) && !guess && *store)
+    guess = bgy3d_restart_load (store, method, &PD, m, solvent_sites,
+                                n, solute_sites);
+
+  if (!(pass && restart_) && !guess)
+    guess = coarse_guess (solute_solve, &PD, m, solvent_sites,
+                          n, solute_sites, qm_density, chi_fft_buf);
+
+  /* The store and  the predictor need the  restart info back also if
+     the caller does not: */
+  Restart **pass_ = pass;
+  if (guess || *store || order > 0)
+    {
+      if (!pass)
+        pass_ = &guess;
+      else if (guess)
+        restart_ = guess;
+    }
+
   /* The code will fill the dictionary with results: */
   SCM dict = SCM_EOL;
 
@@ -1183,7 +1339,18 @@ run_solute (SU solute_solve, SCM solute, SCM solvent,
                 g,              /* out */
                 chi_fft_buf,    /* NULL, or [m][m][nrad] */
                 &medium_,       /* out */
-                pass);          /* NULL, or inout */
+                pass_);         /* NULL, or inout */
+
+  if (*store && pass_ && *pass_)
+    bgy3d_restart_save (store, method, &PD, m, solvent_sites,
+                        n, solute_sites, *pass_);
+
+  if (order > 0 && pass_ && *pass_)
+    bgy3d_restart_remember (method, &PD, m, solvent_sites,
+                            n, solute_sites, *pass_);
+
+  if (pass_ != pass)
+    bgy3d_restart_destroy (guess);
 
   free (solute_name);
   free (solute_sites);
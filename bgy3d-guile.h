@@ -9,6 +9,9 @@
    never returns: */
 int bgy3d_guile_main (int argc, char **argv);
 
+/* Current settings, an association list: */
+SCM guile_get_settings (void);
+
 
 static inline void
 to_int1 (SCM x, int n, int y[n])
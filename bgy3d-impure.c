@@ -100,6 +100,7 @@
 #include "bgy3d-dirichlet.h"    /* Laplace staff */
 #include "bgy3d-potential.h"    /* Context, etc. */
 #include "bgy3d-fftw.h"         /* bgy3d_fft_interp() */
+#include "bgy3d-nufft.h"        /* bgy3d_fft_prolong() */
 #include "bgy3d-snes.h"         /* bgy3d_snes_jager() */
 #include "bgy3d-impure.h"
 
@@ -195,7 +196,7 @@ static void kernel (const DA dc,
                     Vec coul,   /* complex, intent(in) */
                     Vec dfg)    /* complex, intent(out) */
 {
-  int x[3], n[3], i[3];
+  int x[3], n[3], i[3], kdim[3];
 
   const int *N = PD->N;         /* [3] */
   const real *L = PD->L;        /* [3] */
@@ -211,6 +212,7 @@ static void kernel (const DA dc,
 
   /* Get local portion of the grid */
   DMDAGetCorners (dc, &x[0], &x[1], &x[2], &n[0], &n[1], &n[2]);
+  kspace_dims (dc, kdim);
 
   /* Loop over local portion of grid: */
   complex ***fg_[3], ***dfg_, ***coul_;
@@ -228,7 +230,7 @@ static void kernel (const DA dc,
 
           /* Take negative frequencies for i > N/2: */
           FOR_DIM
-            ic[dim] = KFREQ (i[dim], N[dim]);
+            ic[dim] = KFREQ (i[kdim[dim]], N[dim]);
 
           real k2 = SQR(ic[2]) + SQR(ic[1]) + SQR(ic[0]);
 
@@ -600,6 +602,24 @@ void bgy3d_restart_destroy (Restart *restart)
 }
 
 
+/*
+  Used in grid  sequencing, see run_solute() in  bgy3d-guile.c. Both
+  BGY  and HNC/RISM  restart info  is a long Vec  of m  fields on the
+  real space grid that can be interpolated spectrally:
+*/
+Restart* bgy3d_restart_prolong (const int N[3], int m, Restart *restart)
+{
+  Vec U = (Vec) restart;
+  assert (U != NULL);
+
+  Vec V = bgy3d_fft_prolong (N, m, U);
+
+  bgy3d_restart_destroy (restart);
+
+  return (void*) V;
+}
+
+
 /*
   This function  solves the the  BGY3dM equation for a  m-site solvent
   and  an arbitrary  solute.  Solvent  properties in  the form  of the
@@ -814,9 +834,16 @@ static void solute_solve (State *BHD,
 
           bgy3d_snes_picard(),
           bgy3d_snes_jager(),
+          bgy3d_snes_mdiis(),
           bgy3d_snes_newton().
+
+          The hand-tuned  Jager annealing remains the default here, an
+          explicit --snes-solver selects any of them:
         */
-        bgy3d_snes_jager (PD, &ctx, (VecFunc1) iterate_u, NULL, U);
+        if (bgy3d_getopt_test ("snes-solver"))
+          bgy3d_snes_default (PD, &ctx, (VecFunc1) iterate_u, NULL, U);
+        else
+          bgy3d_snes_jager (PD, &ctx, (VecFunc1) iterate_u, NULL, U);
       }
 
       /*
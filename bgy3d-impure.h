@@ -35,3 +35,9 @@ void bgy3d_solute_solve (const ProblemData *PD,
                          Restart **restart); /* inout, optional */
 
 void bgy3d_restart_destroy (Restart *restart);
+
+/*
+  Collective. Interpolates the restart info of m sites from the grid N
+  to the grid 2N. Consumes the argument:
+*/
+Restart* bgy3d_restart_prolong (const int N[3], int m, Restart *restart);
@@ -0,0 +1,443 @@
+/* -*- mode: c; c-basic-offset: 2; -*- vim: set sw=2 tw=70 et sta ai: */
+/*
+  Copyright (c) 2014 Alexei Matveev
+
+  Fast trigonometric  interpolation at  arbitrary points, same result
+  as bgy3d_fft_interp() in bgy3d-fftw3.c  up to a given accuracy. The
+  exact sum over the local k-grid costs O(N³) for each of the np
+  points. Here the  cost is that of one  FFT on a twice finer grid per
+  input, see bgy3d_nufft_set(), and O(np * (2 msp + 1)³) for each
+  batch of points.
+
+  Gaussian gridding in the formulation of  Greengard and Lee, with the
+  oversampling factor 2. In each dimension and in coarse grid units
+  the interpolant
+
+    f(x) = Σ  Y(K) exp (2πi K x / N)
+            K
+
+  is rewritten  as a convolution of a periodic Gaussian with a band
+  limited  function F(x) that has  the coefficients Y(K) / ĝ(K).  The
+  latter is known exactly on the fine grid x = m / 2, 0 <= m < 2N, by
+  an inverse FFT  of the zero-padded coefficients.  The  convolution
+  integral is done by the trapezoidal rule on the same grid which  is
+  exact up to  the tail of the Gaussian. With msp fine points on each
+  side the error is about 10^(-msp).  The width of the Gaussian is
+
+    g(x) = exp (-3π x² / msp)
+
+  and its Fourier transform is, up to a constant factor,
+
+    ĝ(K) = exp (-π msp K² / 3N²)
+
+  The  padding takes the half-complex layout into account. The Nyquist
+  frequencies  of even N are aliased on the coarse grid.  These terms
+  are split equally between the two frequencies ±N/2 of the fine one.
+  This is exactly what bgy3d_fft_interp() does with cos() for them.
+*/
+
+#include "bgy3d.h"
+#include "bgy3d-vec.h"          /* kspace_dims() */
+#include "bgy3d-fftw.h"         /* bgy3d_fft_mat_create() */
+#include "bgy3d-nufft.h"
+#include <complex.h>
+
+/*
+  Zero padding of the coefficients on the k-grid N to the finer k-grid
+  M = 2N.  Each of nt local coarse coefficients, some of them twice or
+  more, goes to the fine grid with the factor fac[] that may include a
+  deconvolution:
+*/
+typedef struct Pad
+{
+  int nt;
+  int *from;                    /* [nt], local index in coarse section */
+  real *fac;                    /* [nt] */
+  Vec src;                      /* complex [nt], fac[] * Y[from[]] */
+  VecScatter scatter;           /* src -> Y_fine */
+} Pad;
+
+
+struct Nufft
+{
+  int N[3], M[3];               /* coarse and fine (M = 2N) grids */
+  int msp;                      /* half-width in fine grid points */
+
+  /* FFT on the fine grid: */
+  Mat fft_mat;
+  DA da, dc;
+
+  Pad *pad;                     /* with deconvolution */
+
+  Vec F;                        /* real, fine grid, or NULL */
+};
+
+
+/* C needs a separate modulo operation, see bgy3d-interp.c: */
+static inline int
+mod (int a, int b)
+{
+  return (a % b + b) % b;
+}
+
+
+/*
+  Collective.  The coarse k-grid  N is  described by dc, the fine one,
+  twice as large, by dc_fine. Each coefficient is scaled by the factor
+  scale and, for msp > 0, by the deconvolution 1 / ĝ(K):
+*/
+static Pad*
+pad_create (const int N[3], const DA dc, const DA dc_fine, int msp, real scale)
+{
+  Pad *pad = malloc (sizeof *pad);
+
+  int M[3];
+  FOR_DIM
+    M[dim] = 2 * N[dim];
+
+  /* Local section of coarse k-grid: */
+  int x[3], n[3], kc[3];
+  DMDAGetCorners (dc, &x[0], &x[1], &x[2], &n[0], &n[1], &n[2]);
+  kspace_dims (dc, kc);
+
+  /* Physical shape of the fine k-grid, maybe transposed too: */
+  int S[3], kf[3];
+  da_shape (dc_fine, S);
+  kspace_dims (dc_fine, kf);
+
+  /* At most four fine targets for each coarse coefficient: */
+  const int nloc = n[0] * n[1] * n[2];
+  int *to = malloc (4 * nloc * sizeof *to);
+  pad->from = malloc (4 * nloc * sizeof *pad->from);
+  pad->fac = malloc (4 * nloc * sizeof *pad->fac);
+
+  int nt = 0, ofs = 0;
+  int p[3];
+  for (p[2] = x[2]; p[2] < x[2] + n[2]; p[2]++)
+    for (p[1] = x[1]; p[1] < x[1] + n[1]; p[1]++)
+      for (p[0] = x[0]; p[0] < x[0] + n[0]; p[0]++, ofs++)
+        {
+          /* Up to two fine indices and split factors per dimension: */
+          int jj[3][2], cnt[3];
+          real ff[3][2];
+          real dec = scale;
+
+          FOR_DIM
+            {
+              const int i = p[kc[dim]];
+
+              /* Half-complex dimension 0 has no negative frequencies: */
+              const int K = (dim == 0) ? i : KFREQ (i, N[dim]);
+
+              /* Deconvolution, 1 / ĝ(K): */
+              if (msp > 0)
+                dec *= exp (M_PI * msp * SQR ((real) K / N[dim]) / 3);
+
+              if (2 * K != N[dim])
+                {
+                  cnt[dim] = 1;
+                  jj[dim][0] = mod (K, M[dim]);
+                  ff[dim][0] = 1.0;
+                }
+              else if (dim == 0)
+                {
+                  /* The conjugate partner is implicit: */
+                  cnt[dim] = 1;
+                  jj[dim][0] = K;
+                  ff[dim][0] = 0.5;
+                }
+              else
+                {
+                  /* Split between +N/2 and -N/2: */
+                  cnt[dim] = 2;
+                  jj[dim][0] = K;
+                  jj[dim][1] = M[dim] - K;
+                  ff[dim][0] = ff[dim][1] = 0.5;
+                }
+            }
+
+          for (int a = 0; a < cnt[0]; a++)
+            for (int b = 0; b < cnt[1]; b++)
+              for (int c = 0; c < cnt[2]; c++)
+                {
+                  const int j[3] = {jj[0][a], jj[1][b], jj[2][c]};
+
+                  int q[3];
+                  FOR_DIM
+                    q[kf[dim]] = j[dim];
+
+                  /* Natural ordering of the fine dc: */
+                  to[nt] = q[0] + S[0] * (q[1] + S[1] * q[2]);
+                  pad->from[nt] = ofs;
+                  pad->fac[nt] = ff[0][a] * ff[1][b] * ff[2][c] * dec;
+                  nt++;
+                }
+        }
+  pad->nt = nt;
+
+  /* Natural to Petsc ordering, the AO is owned by the DA: */
+  {
+    AO ao;
+    DMDAGetAO (dc_fine, &ao);
+    AOApplicationToPetsc (ao, nt, to);
+  }
+
+  /* Two reals for each complex number: */
+  int *idx = malloc (2 * nt * sizeof *idx);
+  for (int t = 0; t < nt; t++)
+    {
+      idx[2 * t] = 2 * to[t];
+      idx[2 * t + 1] = 2 * to[t] + 1;
+    }
+
+  VecCreateMPI (comm_world_petsc, 2 * nt, PETSC_DETERMINE, &pad->src);
+
+  local Vec Y_fine = vec_create (dc_fine);
+
+  int lo, hi;
+  VecGetOwnershipRange (pad->src, &lo, &hi);
+
+  IS is_from, is_to;
+  ISCreateStride (comm_world_petsc, 2 * nt, lo, 1, &is_from);
+  ISCreateGeneral (comm_world_petsc, 2 * nt, idx, PETSC_COPY_VALUES, &is_to);
+
+  VecScatterCreate (pad->src, is_from, Y_fine, is_to, &pad->scatter);
+
+  ISDestroy (&is_from);
+  ISDestroy (&is_to);
+  vec_destroy (&Y_fine);
+  free (idx);
+  free (to);
+
+  return pad;
+}
+
+
+static void
+pad_destroy (Pad *pad)
+{
+  VecScatterDestroy (&pad->scatter);
+  vec_destroy (&pad->src);
+  free (pad->from);
+  free (pad->fac);
+  free (pad);
+}
+
+
+/* Collective. Y_fine := padded Y: */
+static void
+pad_apply (Pad *pad, const Vec Y, Vec Y_fine)
+{
+  {
+    local complex *Y_ = (complex*) vec_get_array (Y);
+    local complex *src_ = (complex*) vec_get_array (pad->src);
+
+    for (int t = 0; t < pad->nt; t++)
+      src_[t] = pad->fac[t] * Y_[pad->from[t]];
+
+    vec_restore_array (Y, (void*) &Y_);
+    vec_restore_array (pad->src, (void*) &src_);
+  }
+
+  VecSet (Y_fine, 0.0);
+  VecScatterBegin (pad->scatter, pad->src, Y_fine, INSERT_VALUES, SCATTER_FORWARD);
+  VecScatterEnd (pad->scatter, pad->src, Y_fine, INSERT_VALUES, SCATTER_FORWARD);
+}
+
+
+Nufft*
+bgy3d_nufft_create (const int N[3], const DA dc, real tol)
+{
+  Nufft *nu = malloc (sizeof *nu);
+
+  FOR_DIM
+    {
+      nu->N[dim] = N[dim];
+      nu->M[dim] = 2 * N[dim];
+    }
+
+  /* Error is about 10^(-msp), more than 14 is useless in double: */
+  nu->msp = ceil (-log10 (tol));
+  if (nu->msp < 2)
+    nu->msp = 2;
+  if (nu->msp > 14)
+    nu->msp = 14;
+
+  /* Collective: */
+  bgy3d_fft_mat_create (nu->M, &nu->fft_mat, &nu->da, &nu->dc);
+
+  nu->pad = pad_create (N, dc, nu->dc, nu->msp, 1.0);
+
+  /* See bgy3d_nufft_set(): */
+  nu->F = NULL;
+
+  return nu;
+}
+
+
+void
+bgy3d_nufft_destroy (Nufft *nu)
+{
+  pad_destroy (nu->pad);
+  if (nu->F)
+    vec_destroy (&nu->F);
+
+  MatDestroy (&nu->fft_mat);
+  DMDestroy (&nu->da);
+  DMDestroy (&nu->dc);
+
+  free (nu);
+}
+
+
+void
+bgy3d_nufft_set (Nufft *nu, const Vec Y)
+{
+  if (nu->F == NULL)
+    nu->F = vec_create (nu->da);
+
+  /* Padded and deconvoluted coefficients on the fine grid: */
+  local Vec Y_fine = vec_create (nu->dc);
+  pad_apply (nu->pad, Y, Y_fine);
+
+  /* F(m / 2), unnormalized inverse FFT: */
+  MatMultTranspose (nu->fft_mat, Y_fine, nu->F);
+
+  vec_destroy (&Y_fine);
+}
+
+
+void
+bgy3d_nufft_interp (Nufft *nu,
+                    int np, double x[np][3], /* intent(in) */
+                    double y[np])            /* intent(out) */
+{
+  const int *N = nu->N;
+  const int *M = nu->M;
+  const int msp = nu->msp;
+
+  assert (nu->F != NULL);       /* see bgy3d_nufft_set() */
+
+  /* Local section of the fine grid: */
+  int c[3], n[3];
+  DMDAGetCorners (nu->da, &c[0], &c[1], &c[2], &n[0], &n[1], &n[2]);
+
+  real ***F_;
+  DMDAVecGetArray (nu->da, nu->F, &F_);
+
+  /* Trapezoidal rule and the constant factor of ĝ(K): */
+  const real a = 3 * M_PI / msp;
+  const real scale = pow (sqrt (3.0 / msp) / 2, 3) / (N[0] * N[1] * N[2]);
+
+  const int w = 2 * msp + 1;
+  for (int p = 0; p < np; p++)
+    {
+      /*
+        Gaussian weights and fine grid indices around the point.  Only
+        those within the local section  contribute here, the sum over
+        workers follows:
+      */
+      real g[3][w];
+      int m[3][w];
+      bool mine[3][w];
+
+      FOR_DIM
+        {
+          const int m0 = floor (2 * x[p][dim] + 0.5);
+
+          for (int o = 0; o < w; o++)
+            {
+              const int mm = m0 + o - msp;
+              const real d = x[p][dim] - 0.5 * mm;
+
+              g[dim][o] = exp (-a * d * d);
+              m[dim][o] = mod (mm, M[dim]);
+              mine[dim][o] = (m[dim][o] >= c[dim] &&
+                              m[dim][o] < c[dim] + n[dim]);
+            }
+        }
+
+      real sum = 0.0;
+      for (int oz = 0; oz < w; oz++)
+        {
+          if (!mine[2][oz])
+            continue;
+
+          for (int oy = 0; oy < w; oy++)
+            {
+              if (!mine[1][oy])
+                continue;
+
+              const real gzy = g[2][oz] * g[1][oy];
+
+              for (int ox = 0; ox < w; ox++)
+                if (mine[0][ox])
+                  sum += gzy * g[0][ox] * F_[m[2][oz]][m[1][oy]][m[0][ox]];
+            }
+        }
+      y[p] = scale * sum;
+    }
+
+  DMDAVecRestoreArray (nu->da, nu->F, &F_);
+
+  /* Each worker summed only over its own fine grid section: */
+  comm_allreduce (np, y);
+}
+
+
+/*
+  Spectral prolongation.  The trigonometric interpolant of y is exact
+  at the  points of the  coarse grid, evaluate  it at all  points of
+  the twice finer grid  by an FFT of the zero-padded coefficients. The
+  coefficients are Y(K) / (N0 N1 N2) with the unnormalized forward FFT
+  Y(K). The Nyquist terms are split as above.
+*/
+Vec
+bgy3d_fft_prolong (const int N[3], int m, const Vec y)
+{
+  int M[3];
+  FOR_DIM
+    M[dim] = 2 * N[dim];
+
+  /* Collective: */
+  Mat fft_coarse, fft_fine;
+  DA da_coarse, dc_coarse, da_fine, dc_fine;
+  bgy3d_fft_mat_create (N, &fft_coarse, &da_coarse, &dc_coarse);
+  bgy3d_fft_mat_create (M, &fft_fine, &da_fine, &dc_fine);
+
+  Pad *pad = pad_create (N, dc_coarse, dc_fine, 0, /* no deconvolution */
+                         1.0 / ((real) N[0] * N[1] * N[2]));
+
+  Vec x = vec_pack_create1 (da_fine, m);
+
+  local Vec Y = vec_create (dc_coarse);
+  local Vec Y_fine = vec_create (dc_fine);
+  {
+    local Vec ys[m], xs[m];
+    vec_aliases_create1 (y, m, ys);
+    vec_aliases_create1 (x, m, xs);
+
+    for (int i = 0; i < m; i++)
+      {
+        MatMult (fft_coarse, ys[i], Y);
+        pad_apply (pad, Y, Y_fine);
+        MatMultTranspose (fft_fine, Y_fine, xs[i]);
+      }
+
+    vec_aliases_destroy1 (y, m, ys);
+    vec_aliases_destroy1 (x, m, xs);
+  }
+  vec_destroy (&Y);
+  vec_destroy (&Y_fine);
+
+  pad_destroy (pad);
+
+  MatDestroy (&fft_coarse);
+  MatDestroy (&fft_fine);
+  DMDestroy (&da_coarse);
+  DMDestroy (&dc_coarse);
+  DMDestroy (&da_fine);
+  DMDestroy (&dc_fine);
+
+  return x;
+}
@@ -0,0 +1,32 @@
+/* -*- mode: c; c-basic-offset: 2; -*- vim: set sw=2 tw=70 et sta ai: */
+/*
+  Copyright (c) 2014 Alexei Matveev
+*/
+
+typedef struct Nufft Nufft;     /* opaque */
+
+/* Collective. Relative accuracy tol, e.g. 1e-10: */
+Nufft* bgy3d_nufft_create (const int N[3], const DA dc, real tol);
+void bgy3d_nufft_destroy (Nufft *nu);
+
+/*
+  Collective. Prepares  the interpolation of  the complex coefficients
+  Y, see bgy3d_fft_interp().  This does the FFT on the fine grid, call
+  it once per Vec:
+*/
+void bgy3d_nufft_set (Nufft *nu, const Vec Y);
+
+/*
+  Same semantics  as bgy3d_fft_interp()  for the coefficients  of the
+  last bgy3d_nufft_set(), collective too:
+*/
+void bgy3d_nufft_interp (Nufft *nu,
+                         int np, double x[np][3], /* intent(in) */
+                         double y[np]);           /* intent(out) */
+
+/*
+  Collective.  Returns  m real fields on the grid 2N interpolated from
+  the  long Vec  y with  m fields on  the grid  N, both  packed as by
+  vec_pack_create1(). Destroy with vec_pack_destroy1():
+*/
+Vec bgy3d_fft_prolong (const int N[3], int m, const Vec y);
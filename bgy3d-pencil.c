@@ -0,0 +1,477 @@
+/* -*- mode: c; c-basic-offset: 2; -*- vim: set sw=2 tw=70 et sta ai: */
+/*
+  Copyright (c) 2014 Alexei Matveev
+*/
+
+/*
+  Pencil decomposition of  the 3D FFT. FFTW-MPI distributes  the work
+  in slabs along N[2]  only, see comments to bgy3d_fft_mat_create(),
+  which  limits the number of  workers by N[2]. Here the  workers are
+  arranged in a p1 x p2 grid, the real-space data  is distributed over
+  N[1] and N[2] with the stride-1 dimension N[0] kept local:
+
+    x[k][j][i], k in K(r2), j in J(r1), 0 <= i < N[0]
+
+  The k-space data is laid out in the same way, with N[0] / 2 + 1 for
+  the stride-1 dimension, so that the array descriptors da and dc are
+  just two DAs with the same  2D partition.  Local transforms  along
+  the three axes are interleaved with two transposes:
+
+    L0:  [k in K(r2)][j in J(r1)][i < NH]     FFT along i (r2c/c2r)
+    L1:  [k in K(r2)][i in I(r1)][j < N1]     FFT along j
+    L2:  [i in I(r1)][j in J'(r2)][k < N2]    FFT along k
+
+  Transposes between L0 and L1  are all-to-all exchanges within rows
+  (same r2) of the  process grid, those between L1 and L2 within the
+  columns (same r1). Returning back  to L0 takes two more transposes.
+  Each of them  involves only p1 or p2 workers  though, so that the
+  communication scales better than that of slabs for large np.
+*/
+
+#include "bgy3d.h"
+#include <fftw3.h>
+#include "bgy3d-vec.h"          /* da_create() */
+#include "bgy3d-pencil.h"
+#include <complex.h>            /* after fftw3.h */
+
+struct Pencil
+{
+  int N[3];                     /* grid shape */
+  int NH;                       /* N[0] / 2 + 1 */
+
+  /* Process grid p1 x p2, my coordinates r1 and r2: */
+  int p1, p2, r1, r2;
+  MPI_Comm row, col;            /* same r2, same r1 */
+
+  /* Partitions and offsets, see partition(): */
+  int *lj, *oj;                 /* N[1] over p1 */
+  int *lk, *ok;                 /* N[2] over p2 */
+  int *li, *oi;                 /* NH over p1 */
+  int *lj2, *oj2;               /* N[1] over p2 */
+
+  /* Local dimensions, nk = lk[r2], nj = lj[r1], ni = li[r1], nj2 = lj2[r2] */
+  int nk, nj, ni, nj2;
+
+  /* Scratch for L0, L1, L2, and for communication: */
+  complex *buf0, *buf1, *buf2, *send, *recv;
+
+  /* Counts and displacements for MPI_Alltoallv(), in doubles: */
+  int *scount, *sdispl, *rcount, *rdispl;
+
+  /* NULL plans stand for empty local sections: */
+  fftw_plan r2c, c2r, fwj, bwj, fwk, bwk;
+};
+
+
+static void partition (int n, int p, int l[p], int o[p])
+{
+  int off = 0;
+  for (int q = 0; q < p; q++)
+    {
+      l[q] = n / p + (q < n % p);
+      o[q] = off;
+      off += l[q];
+    }
+}
+
+
+static void execute (fftw_plan plan)
+{
+  if (plan)
+    fftw_execute (plan);
+}
+
+
+/* Counts are in complex numbers here, MPI is told about doubles: */
+static void exchange (Pencil *pen, MPI_Comm comm, int p)
+{
+  int soff = 0, roff = 0;
+  for (int q = 0; q < p; q++)
+    {
+      pen->scount[q] *= 2;
+      pen->rcount[q] *= 2;
+      pen->sdispl[q] = soff;
+      pen->rdispl[q] = roff;
+      soff += pen->scount[q];
+      roff += pen->rcount[q];
+    }
+
+  int err = MPI_Alltoallv (pen->send, pen->scount, pen->sdispl, MPI_DOUBLE,
+                           pen->recv, pen->rcount, pen->rdispl, MPI_DOUBLE,
+                           comm);
+  assert (err == MPI_SUCCESS);
+}
+
+
+/*
+  L0 <-> L1 within a row. Forward, the worker sends (k, j in J(me), i
+  in I(q)) to row peer q and receives (k, j in J(q), i in I(me)).  The
+  back transpose is the mirror image of that.
+*/
+static void transpose1 (Pencil *pen, complex *buf0, bool back)
+{
+  const int nk = pen->nk, nj = pen->nj, ni = pen->ni;
+  const int NH = pen->NH, N1 = pen->N[1];
+  const int p = pen->p1;
+  const int *lj = pen->lj, *oj = pen->oj, *li = pen->li, *oi = pen->oi;
+
+  complex (*x0)[nj][NH] = (void*) buf0;
+  complex (*x1)[ni][N1] = (void*) pen->buf1;
+
+  complex *restrict s = pen->send;
+  for (int q = 0; q < p; q++)
+    if (!back)
+      {
+        for (int k = 0; k < nk; k++)
+          for (int j = 0; j < nj; j++)
+            for (int i = 0; i < li[q]; i++)
+              *s++ = x0[k][j][oi[q] + i];
+
+        pen->scount[q] = nk * nj * li[q];
+        pen->rcount[q] = nk * lj[q] * ni;
+      }
+    else
+      {
+        for (int k = 0; k < nk; k++)
+          for (int j = 0; j < lj[q]; j++)
+            for (int i = 0; i < ni; i++)
+              *s++ = x1[k][i][oj[q] + j];
+
+        pen->scount[q] = nk * lj[q] * ni;
+        pen->rcount[q] = nk * nj * li[q];
+      }
+
+  exchange (pen, pen->row, p);
+
+  const complex *restrict r = pen->recv;
+  for (int q = 0; q < p; q++)
+    if (!back)
+      {
+        for (int k = 0; k < nk; k++)
+          for (int j = 0; j < lj[q]; j++)
+            for (int i = 0; i < ni; i++)
+              x1[k][i][oj[q] + j] = *r++;
+      }
+    else
+      {
+        for (int k = 0; k < nk; k++)
+          for (int j = 0; j < nj; j++)
+            for (int i = 0; i < li[q]; i++)
+              x0[k][j][oi[q] + i] = *r++;
+      }
+}
+
+
+/*
+  L1 <->  L2 within a column.  Forward, the worker  sends (k in K(me),
+  i, j in J'(q)) to column peer q and receives (k in K(q), i, j in
+  J'(me)).  All column peers share the same range I(r1).
+*/
+static void transpose2 (Pencil *pen, bool back)
+{
+  const int nk = pen->nk, ni = pen->ni, nj2 = pen->nj2;
+  const int N1 = pen->N[1], N2 = pen->N[2];
+  const int p = pen->p2;
+  const int *lk = pen->lk, *ok = pen->ok, *lj2 = pen->lj2, *oj2 = pen->oj2;
+
+  complex (*x1)[ni][N1] = (void*) pen->buf1;
+  complex (*x2)[nj2][N2] = (void*) pen->buf2;
+
+  complex *restrict s = pen->send;
+  for (int q = 0; q < p; q++)
+    if (!back)
+      {
+        for (int k = 0; k < nk; k++)
+          for (int i = 0; i < ni; i++)
+            for (int j = 0; j < lj2[q]; j++)
+              *s++ = x1[k][i][oj2[q] + j];
+
+        pen->scount[q] = nk * ni * lj2[q];
+        pen->rcount[q] = lk[q] * ni * nj2;
+      }
+    else
+      {
+        for (int k = 0; k < lk[q]; k++)
+          for (int i = 0; i < ni; i++)
+            for (int j = 0; j < nj2; j++)
+              *s++ = x2[i][j][ok[q] + k];
+
+        pen->scount[q] = lk[q] * ni * nj2;
+        pen->rcount[q] = nk * ni * lj2[q];
+      }
+
+  exchange (pen, pen->col, p);
+
+  const complex *restrict r = pen->recv;
+  for (int q = 0; q < p; q++)
+    if (!back)
+      {
+        for (int k = 0; k < lk[q]; k++)
+          for (int i = 0; i < ni; i++)
+            for (int j = 0; j < nj2; j++)
+              x2[i][j][ok[q] + k] = *r++;
+      }
+    else
+      {
+        for (int k = 0; k < nk; k++)
+          for (int i = 0; i < ni; i++)
+            for (int j = 0; j < lj2[q]; j++)
+              x1[k][i][oj2[q] + j] = *r++;
+      }
+}
+
+
+/* Complex transforms along j and  k, in place, data in L0 layout: */
+static void fft_jk (Pencil *pen, complex *buf0, int sign)
+{
+  transpose1 (pen, buf0, false);
+  execute (sign == FFTW_FORWARD ? pen->fwj : pen->bwj);
+
+  transpose2 (pen, false);
+  execute (sign == FFTW_FORWARD ? pen->fwk : pen->bwk);
+  transpose2 (pen, true);
+
+  transpose1 (pen, buf0, true);
+}
+
+
+/*
+  Does y  = A * x.  The real-to-complex transform  along i writes into
+  the storage of  Vec y directly, the rest of the work  is done there
+  in-place. The input Vec x is preserved.
+*/
+void bgy3d_pencil_forward (Pencil *pen, Vec x, Vec y)
+{
+  PetscScalar *x_, *y_;
+  VecGetArray (x, &x_);
+  VecGetArray (y, &y_);
+
+  if (pen->r2c)
+    fftw_execute_dft_r2c (pen->r2c, x_, (fftw_complex*) y_);
+
+  fft_jk (pen, (complex*) y_, FFTW_FORWARD);
+
+  VecRestoreArray (x, &x_);
+  VecRestoreArray (y, &y_);
+}
+
+
+/* Does y = A^T *  x, the inverse FFT.  Vec x is  preserved, but not the
+   copy of it: */
+void bgy3d_pencil_backward (Pencil *pen, Vec x, Vec y)
+{
+  const int n = pen->nk * pen->nj * pen->NH;
+
+  PetscScalar *x_, *y_;
+  VecGetArray (x, &x_);
+  memcpy (pen->buf0, x_, n * sizeof (complex));
+  VecRestoreArray (x, &x_);
+
+  fft_jk (pen, pen->buf0, FFTW_BACKWARD);
+
+  VecGetArray (y, &y_);
+
+  if (pen->c2r)
+    fftw_execute_dft_c2r (pen->c2r, (fftw_complex*) pen->buf0, y_);
+
+  VecRestoreArray (y, &y_);
+}
+
+
+static int imax (int a, int b)
+{
+  return a > b ? a : b;
+}
+
+
+Pencil* bgy3d_pencil_create (const int N[3], int p1, unsigned flags,
+                             DA *da, DA *dc)
+{
+  int np, id;
+  MPI_Comm_size (comm_world_petsc, &np);
+  MPI_Comm_rank (comm_world_petsc, &id);
+
+  if (np % p1 != 0 || N[1] < p1 || N[2] < np / p1)
+    {
+      PRINTF ("Cannot arrange %d workers in %d x %d pencils for %d x %d grid\n",
+              np, p1, np / p1, N[1], N[2]);
+      exit (1);
+    }
+
+  Pencil *pen = malloc (sizeof *pen);
+
+  FOR_DIM
+    pen->N[dim] = N[dim];
+  pen->NH = N[0] / 2 + 1;
+
+  /*
+    Petsc  numbers the workers  with the x-direction fastest, there is
+    only one worker in that direction:
+  */
+  pen->p1 = p1;
+  pen->p2 = np / p1;
+  pen->r1 = id % p1;
+  pen->r2 = id / p1;
+
+  MPI_Comm_split (comm_world_petsc, pen->r2, pen->r1, &pen->row);
+  MPI_Comm_split (comm_world_petsc, pen->r1, pen->r2, &pen->col);
+
+  const int p1_ = pen->p1, p2_ = pen->p2;
+
+  pen->lj = malloc (p1_ * sizeof (int));
+  pen->oj = malloc (p1_ * sizeof (int));
+  pen->li = malloc (p1_ * sizeof (int));
+  pen->oi = malloc (p1_ * sizeof (int));
+  pen->lk = malloc (p2_ * sizeof (int));
+  pen->ok = malloc (p2_ * sizeof (int));
+  pen->lj2 = malloc (p2_ * sizeof (int));
+  pen->oj2 = malloc (p2_ * sizeof (int));
+
+  partition (N[1], p1_, pen->lj, pen->oj);
+  partition (pen->NH, p1_, pen->li, pen->oi);
+  partition (N[2], p2_, pen->lk, pen->ok);
+  partition (N[1], p2_, pen->lj2, pen->oj2);
+
+  const int nk = pen->nk = pen->lk[pen->r2];
+  const int nj = pen->nj = pen->lj[pen->r1];
+  const int ni = pen->ni = pen->li[pen->r1];
+  const int nj2 = pen->nj2 = pen->lj2[pen->r2];
+
+  {
+    const int pmax = imax (p1_, p2_);
+    pen->scount = malloc (pmax * sizeof (int));
+    pen->sdispl = malloc (pmax * sizeof (int));
+    pen->rcount = malloc (pmax * sizeof (int));
+    pen->rdispl = malloc (pmax * sizeof (int));
+  }
+
+  /* Sizes of L0, L1, and L2 local sections: */
+  const int n0 = nk * nj * pen->NH;
+  const int n1 = nk * ni * N[1];
+  const int n2 = ni * nj2 * N[2];
+  const int nmax = imax (n0, imax (n1, n2));
+
+  pen->buf0 = (complex*) fftw_alloc_complex (n0);
+  pen->buf1 = (complex*) fftw_alloc_complex (n1);
+  pen->buf2 = (complex*) fftw_alloc_complex (n2);
+  pen->send = (complex*) fftw_alloc_complex (nmax);
+  pen->recv = (complex*) fftw_alloc_complex (nmax);
+
+  /*
+    The  r2c and  c2r plans  are executed on  Vec storage  with the new
+    array interface, alignment of which is not under our control.  The
+    real array is only used for planning:
+  */
+  pen->r2c = pen->c2r = NULL;
+  if (nk * nj > 0)
+    {
+      double *doubl = fftw_alloc_real (nk * nj * N[0]);
+      fftw_complex *cmplx = (fftw_complex*) pen->buf0;
+
+      pen->r2c = fftw_plan_many_dft_r2c (1, &N[0], nk * nj,
+                                         doubl, NULL, 1, N[0],
+                                         cmplx, NULL, 1, pen->NH,
+                                         flags | FFTW_UNALIGNED);
+      pen->c2r = fftw_plan_many_dft_c2r (1, &N[0], nk * nj,
+                                         cmplx, NULL, 1, pen->NH,
+                                         doubl, NULL, 1, N[0],
+                                         flags | FFTW_UNALIGNED);
+      fftw_free (doubl);
+      assert (pen->r2c != NULL);
+      assert (pen->c2r != NULL);
+    }
+
+  /* In-place complex transforms along the contiguous axis of L1: */
+  pen->fwj = pen->bwj = NULL;
+  if (nk * ni > 0)
+    {
+      fftw_complex *x1 = (fftw_complex*) pen->buf1;
+
+      pen->fwj = fftw_plan_many_dft (1, &N[1], nk * ni,
+                                     x1, NULL, 1, N[1],
+                                     x1, NULL, 1, N[1],
+                                     FFTW_FORWARD, flags);
+      pen->bwj = fftw_plan_many_dft (1, &N[1], nk * ni,
+                                     x1, NULL, 1, N[1],
+                                     x1, NULL, 1, N[1],
+                                     FFTW_BACKWARD, flags);
+      assert (pen->fwj != NULL);
+      assert (pen->bwj != NULL);
+    }
+
+  /* ... and along the contiguous axis of L2: */
+  pen->fwk = pen->bwk = NULL;
+  if (ni * nj2 > 0)
+    {
+      fftw_complex *x2 = (fftw_complex*) pen->buf2;
+
+      pen->fwk = fftw_plan_many_dft (1, &N[2], ni * nj2,
+                                     x2, NULL, 1, N[2],
+                                     x2, NULL, 1, N[2],
+                                     FFTW_FORWARD, flags);
+      pen->bwk = fftw_plan_many_dft (1, &N[2], ni * nj2,
+                                     x2, NULL, 1, N[2],
+                                     x2, NULL, 1, N[2],
+                                     FFTW_BACKWARD, flags);
+      assert (pen->fwk != NULL);
+      assert (pen->bwk != NULL);
+    }
+
+  /*
+    Array descriptors  for real and complex Vecs  share the partition
+    of N[1] and N[2].  The stride-1 dimension is local:
+  */
+  {
+    int l0[1] = {N[0]};
+    int l0half[1] = {pen->NH};
+
+    *da = da_create (1, 1, l0, p1_, pen->lj, p2_, pen->lk);
+    *dc = da_create (2, 1, l0half, p1_, pen->lj, p2_, pen->lk);
+  }
+
+  /* Make sure Petsc agrees on who is where: */
+  {
+    int x[3], n[3];
+    DMDAGetCorners (*dc, &x[0], &x[1], &x[2], &n[0], &n[1], &n[2]);
+    assert (x[0] == 0 && n[0] == pen->NH);
+    assert (x[1] == pen->oj[pen->r1] && n[1] == nj);
+    assert (x[2] == pen->ok[pen->r2] && n[2] == nk);
+  }
+
+  return pen;
+}
+
+
+void bgy3d_pencil_destroy (Pencil *pen)
+{
+  fftw_plan plans[] = {pen->r2c, pen->c2r, pen->fwj, pen->bwj, pen->fwk, pen->bwk};
+
+  for (int i = 0; i < (int) (sizeof plans / sizeof plans[0]); i++)
+    if (plans[i])
+      fftw_destroy_plan (plans[i]);
+
+  fftw_free (pen->buf0);
+  fftw_free (pen->buf1);
+  fftw_free (pen->buf2);
+  fftw_free (pen->send);
+  fftw_free (pen->recv);
+
+  free (pen->scount);
+  free (pen->sdispl);
+  free (pen->rcount);
+  free (pen->rdispl);
+
+  free (pen->lj);
+  free (pen->oj);
+  free (pen->li);
+  free (pen->oi);
+  free (pen->lk);
+  free (pen->ok);
+  free (pen->lj2);
+  free (pen->oj2);
+
+  MPI_Comm_free (&pen->row);
+  MPI_Comm_free (&pen->col);
+
+  free (pen);
+}
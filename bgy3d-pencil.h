@@ -0,0 +1,14 @@
+/* -*- mode: c; c-basic-offset: 2; -*- vim: set sw=2 tw=70 et sta ai: */
+/*
+  Copyright (c) 2014 Alexei Matveev
+*/
+
+typedef struct Pencil Pencil;   /* opaque */
+
+Pencil* bgy3d_pencil_create (const int N[3], int p1, unsigned flags,
+                             DA *da, DA *dc); /* out */
+void bgy3d_pencil_destroy (Pencil *pen);
+
+/* Same semantics as MatMult() and MatMultTranspose() of FFT matrix: */
+void bgy3d_pencil_forward (Pencil *pen, Vec x, Vec y);
+void bgy3d_pencil_backward (Pencil *pen, Vec x, Vec y);
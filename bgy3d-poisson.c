@@ -147,8 +147,9 @@ void bgy3d_poisson (const State *BHD, Vec uc_fft, Vec rho, real q)
 
   /* Loop over local portion of the k-grid */
   {
-    int x[3], n[3], i[3];
+    int x[3], n[3], i[3], kdim[3];
     DMDAGetCorners (BHD->dc, &x[0], &x[1], &x[2], &n[0], &n[1], &n[2]);
+    kspace_dims (BHD->dc, kdim);
 
     complex ***uc_fft_;
     DMDAVecGetArray (BHD->dc, uc_fft, &uc_fft_);
@@ -161,7 +162,7 @@ void bgy3d_poisson (const State *BHD, Vec uc_fft, Vec rho, real q)
 
             /* Take negative frequencies for i > N/2: */
             FOR_DIM
-              k[dim] = KFREQ (i[dim], N[dim]) * dk[dim];
+              k[dim] = KFREQ (i[kdim[dim]], N[dim]) * dk[dim];
 
             /*
               For i,  j, and k less  than or equal to  N/2 and uniform
@@ -216,8 +217,9 @@ void bgy3d_poisson (const State *BHD, Vec uc_fft, Vec rho, real q)
 
   /* Loop over local portion of the k-grid */
   {
-    int i0, j0, k0, ni, nj, nk;
+    int i0, j0, k0, ni, nj, nk, kdim[3];
     DMDAGetCorners (BHD->dc, &i0, &j0, &k0, &ni, &nj, &nk);
+    kspace_dims (BHD->dc, kdim);
 
     complex ***uc_fft_;
     DMDAVecGetArray (BHD->dc, uc_fft, &uc_fft_);
@@ -226,6 +228,9 @@ void bgy3d_poisson (const State *BHD, Vec uc_fft, Vec rho, real q)
       for (int j = j0; j < j0 + nj; j++)
         for (int i = i0; i < i0 + ni; i++)
           {
+            /* Indices in the order of real grid dimensions: */
+            const int ijk[3] = {i, j, k};
+
             /*
               For small  i, j, and k  and uniform box of  size L this
               expression approximates to (π/L)² (i² + j² + k²).
@@ -233,9 +238,9 @@ void bgy3d_poisson (const State *BHD, Vec uc_fft, Vec rho, real q)
               FIXME: SQR() macro evaluates the argument twice!
             */
             const real k2 =                             \
-              SQR (sin (M_PI * i / N[0]) / h[0]) +
-              SQR (sin (M_PI * j / N[1]) / h[1]) +
-              SQR (sin (M_PI * k / N[2]) / h[2]);
+              SQR (sin (M_PI * ijk[kdim[0]] / N[0]) / h[0]) +
+              SQR (sin (M_PI * ijk[kdim[1]] / N[1]) / h[1]) +
+              SQR (sin (M_PI * ijk[kdim[2]] / N[2]) / h[2]);
 
             real fac;
             if (likely (k2 != 0.0))
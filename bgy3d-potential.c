@@ -38,7 +38,7 @@
 #include "bgy3d.h"
 #include "bgy3d-solutes.h"      /* struct Site */
 #include "bgy3d-vec.h"          /* vec_ref(), ... */
-#include "bgy3d-fftw.h"         /* bgy3d_fft_interp() */
+#include "bgy3d-nufft.h"        /* bgy3d_nufft_interp() */
 #include "bgy3d-getopt.h"        /* bgy3d_getopt_test() */
 #include "bgy3d-potential.h"
 #include "bgy3d-poisson.h"      /* bgy3d_poisson() */
@@ -50,7 +50,8 @@
 struct Context {
   DA da, dc;                 /* real and complex array descriptors */
   Mat fft_mat;               /* FFT matrix for interpolation */
-  Vec v, v_fft;              /* refs to real and complex vectors */
+  Vec v;                     /* ref to the real vector */
+  Nufft *nufft;              /* fast trigonometric interpolation */
   PetscScalar ***v_;         /* v_[k][j][i] points to the real data */
   int ijk;                   /* linarized index for local (k, j, i) */
   real h[3];                 /* mesh sizes */
@@ -99,7 +100,7 @@ static Context* bgy3d_pot_create (const State *BHD, Vec v)
 
   /* The first  time interpolation is requested we  put here something
      more usefull: */
-  s->v_fft = NULL;
+  s->nufft = NULL;
 
   /* From  now  on  v_[k][j][i]  can   be  used  to  access  a  vector
      element: */
@@ -124,11 +125,21 @@ static Context* bgy3d_pot_create (const State *BHD, Vec v)
 
 void bgy3d_pot_interp (Context *s, int n, /* const */ real x[n][3], real v[n])
 {
-  /* Prepare Fourier coefficients, if not has been already done: */
-  if (s->v_fft == NULL)
+  /*
+    Prepare  Fourier coefficients  and the  fine grid  once,  if not has
+    been already done. The coefficients are not needed afterwards:
+  */
+  if (s->nufft == NULL)
     {
-      s->v_fft = vec_create (s->dc); /* complex */
-      MatMult (s->fft_mat, s->v, s->v_fft);
+      local Vec v_fft = vec_create (s->dc); /* complex */
+      MatMult (s->fft_mat, s->v, v_fft);
+
+      int N[3];
+      da_shape (s->da, N);
+      s->nufft = bgy3d_nufft_create (N, s->dc, 1.0e-10);
+      bgy3d_nufft_set (s->nufft, v_fft);
+
+      vec_destroy (&v_fft);
     }
 
   /* Translate site coordinates into real grid coordinates where
@@ -138,8 +149,11 @@ void bgy3d_pot_interp (Context *s, int n, /* const */ real x[n][3], real v[n])
     FOR_DIM
       y[i][dim] = (x[i][dim] + s->L[dim] / 2) / s->h[dim];
 
-  /* Trigonometric interpolation: */
-  bgy3d_fft_interp (s->fft_mat, s->v_fft, n, y, v);
+  /*
+    Trigonometric  interpolation.  The  exact  bgy3d_fft_interp() costs
+    O(N³) per point:
+  */
+  bgy3d_nufft_interp (s->nufft, n, y, v);
 }
 
 
@@ -208,8 +222,8 @@ void bgy3d_pot_destroy (Context *s)
   vec_destroy (&s->v);
 
   /* Only if interpolation was really used: */
-  if (s->v_fft)
-    vec_destroy (&s->v_fft);
+  if (s->nufft)
+    bgy3d_nufft_destroy (s->nufft);
 
   /* free the whole context */
   free (s);
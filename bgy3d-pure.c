@@ -94,8 +94,9 @@ static void kapply (const State *BHD,
     DMDAVecGetArray (BHD->dc, fg2_fft[dim], &fg2_fft_[dim]);
 
   /* Get local portion of the k-grid */
-  int x[3], n[3], i[3];
+  int x[3], n[3], i[3], kdim[3];
   DMDAGetCorners (BHD->dc, &x[0], &x[1], &x[2], &n[0], &n[1], &n[2]);
+  kspace_dims (BHD->dc, kdim);
 
   /* loop over local portion of grid */
   for (i[2] = x[2]; i[2] < x[2] + n[2]; i[2]++)
@@ -106,7 +107,7 @@ static void kapply (const State *BHD,
 
           /* Take negative frequencies for i > N/2: */
           FOR_DIM
-            ic[dim] = KFREQ (i[dim], N[dim]);
+            ic[dim] = KFREQ (i[kdim[dim]], N[dim]);
 
           /* FIXME: integer sum of squares will overflow for N >> 20000! */
           const int k2 = SQR (ic[2]) + SQR (ic[1]) + SQR (ic[0]);
@@ -250,8 +251,9 @@ void omega_intra (const ProblemData *PD, const DA dc, real r, Vec w_fft)
   assert (L[0] == L[2]);
 
   /* Get local portion of the k-grid */
-  int x[3], n[3], i[3];
+  int x[3], n[3], i[3], kdim[3];
   DMDAGetCorners (dc, &x[0], &x[1], &x[2], &n[0], &n[1], &n[2]);
+  kspace_dims (dc, kdim);
 
   complex ***w_fft_;
   DMDAVecGetArray (dc, w_fft, &w_fft_);
@@ -265,7 +267,7 @@ void omega_intra (const ProblemData *PD, const DA dc, real r, Vec w_fft)
 
           /* Take negative frequencies for i > N/2: */
           FOR_DIM
-            ic[dim] = KFREQ (i[dim], N[dim]);
+            ic[dim] = KFREQ (i[kdim[dim]], N[dim]);
 
           /* FIXME: integer sum of squares will overflow for N >> 20000! */
           const int k2 = SQR (ic[2]) + SQR (ic[1]) + SQR (ic[0]);
@@ -513,8 +515,9 @@ static void Compute_dg_intra (State *BHD,
   }
 
   /* Get local portion of the k-grid */
-  int x[3], n[3], i[3];
+  int x[3], n[3], i[3], kdim[3];
   DMDAGetCorners (BHD->dc, &x[0], &x[1], &x[2], &n[0], &n[1], &n[2]);
+  kspace_dims (BHD->dc, kdim);
 
   complex ***wbc_fft_, ***dg_fft_, ***cac_fft_;
   complex ***fg2_fft_[3];
@@ -533,7 +536,7 @@ static void Compute_dg_intra (State *BHD,
 
           /* Take negative frequencies for i > N/2: */
           FOR_DIM
-            ic[dim] = KFREQ (i[dim], N[dim]);
+            ic[dim] = KFREQ (i[kdim[dim]], N[dim]);
 
           /* FIXME: integer sum of squares will overflow for N >> 20000! */
           const int k2 = SQR (ic[2]) + SQR (ic[1]) + SQR (ic[0]);
@@ -603,7 +606,7 @@ static void Compute_dg_intra (State *BHD,
 
           /* Take negative frequencies for i > N/2: */
           FOR_DIM
-            ic[dim] = KFREQ (i[dim], N[dim]);
+            ic[dim] = KFREQ (i[kdim[dim]], N[dim]);
 
           /* FIXME: integer sum of squares will overflow for N >> 20000! */
           const int k2 = SQR (ic[2]) + SQR (ic[1]) + SQR (ic[0]);
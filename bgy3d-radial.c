@@ -0,0 +1,451 @@
+/* -*- mode: c; c-basic-offset: 2; -*- vim: set sw=2 tw=70 et sta ai: */
+/*
+  Copyright (c) 2014 Alexei Matveev
+
+  Pure solvent BGY  on the radial grid. The site-site distributions
+  of the pure solvent are spherically symmetric, so the equations of
+  bgy3d_solve_solvent() in  bgy3d-pure.c  may be solved for  nrad
+  points  instead of N³.  The  operations used  there  have  simple
+  radial counterparts:
+
+  1. A 3D FFT of a spherically symmetric function is the sine transform
+     on the grids r = (i + 1/2) dr, k = (j + 1/2) dk with dr * dk = π
+     / nrad, same as in ./rism.f90, see rism_dst().
+
+  2. The  inverse divergence,  -i k·F(k) / k², of a  radial vector
+     field  v(r) r̂  is the potential φ  with  ∇φ = v r̂ vanishing at
+     infinity, that is φ(r) = -∫ v(s) ds from r to infinity.
+
+  3. A convolution with a radial vector field is the gradient of the
+     convolution with its potential.
+
+  The  origin at  the  k = 0 component  of the 3D FFT  is  simply
+  absent  on  the  staggered  k-grid.  Functions  that tend to  one
+  are convolved as 1 + (f - 1).  The Laplace boundary condition of
+  the 3D code is  replaced by  potentials that vanish at infinity.
+*/
+
+#include "bgy3d.h"
+#include "bgy3d-solutes.h"      /* struct Site */
+#include "bgy3d-solvents.h"     /* G_COULOMB_INVERSE_RANGE, needs Site */
+#include "bgy3d-force.h"        /* lennard_jones() */
+#include "bgy3d-getopt.h"
+#include "bgy3d-vec.h"          /* vec_rtab() */
+#include "rism-dst.h"           /* rism_dst() */
+#include "bgy3d-radial.h"
+
+/* Same as in bgy3d-pure.c: */
+static const real NORM_REG = 1.0e-1;
+static const real NORM_REG2 = 1.0e-2;
+
+
+/* 3D Fourier transform of a radial function f(r) -> f(k): */
+static void
+fourier (int n, real dr, const real f[n], real fk[n])
+{
+  const real dk = M_PI / (n * dr);
+
+  real tmp[n];
+  for (int i = 0; i < n; i++)
+    tmp[i] = (i + 0.5) * dr * f[i];
+
+  rism_dst (n, fk, tmp);
+
+  for (int j = 0; j < n; j++)
+    fk[j] *= 2 * M_PI * dr / ((j + 0.5) * dk);
+}
+
+
+/* Inverse of fourier(), f(k) -> f(r): */
+static void
+fourier_inv (int n, real dr, const real fk[n], real f[n])
+{
+  const real dk = M_PI / (n * dr);
+
+  real tmp[n];
+  for (int j = 0; j < n; j++)
+    tmp[j] = (j + 0.5) * dk * fk[j];
+
+  rism_dst (n, f, tmp);
+
+  for (int i = 0; i < n; i++)
+    f[i] *= dk / (4 * M_PI * M_PI * (i + 0.5) * dr);
+}
+
+
+/* y = x * w for x given by x(k) and w(k): */
+static void
+convolve (int n, real dr, const real xk[n], const real wk[n], real y[n])
+{
+  real yk[n];
+  for (int j = 0; j < n; j++)
+    yk[j] = xk[j] * wk[j];
+
+  fourier_inv (n, dr, yk, y);
+}
+
+
+/* φ(r) = -∫ v(s) ds from r to infinity, midpoint rule: */
+static void
+potential (int n, real dr, const real v[n], real phi[n])
+{
+  real sum = 0.0;
+  for (int i = n - 1; i >= 0; i--)
+    {
+      phi[i] = -(sum + v[i] / 2) * dr;
+      sum += v[i];
+    }
+}
+
+
+/* Radial derivative by central differences: */
+static void
+derivative (int n, real dr, const real f[n], real df[n])
+{
+  assert (n > 1);
+
+  for (int i = 1; i < n - 1; i++)
+    df[i] = (f[i + 1] - f[i - 1]) / (2 * dr);
+
+  df[0] = (f[1] - f[0]) / dr;
+  df[n - 1] = (f[n - 1] - f[n - 2]) / dr;
+}
+
+
+/*
+  Normalization  function n(r) = 1 + (h * ω)(r) of  the NSSA  for h(k)
+  and ω(k) = sinc(kd), made positive. See nssa_norm_intra():
+*/
+static void
+norm_intra (int n, real dr, const real hk[n], const real wk[n], real nab[n])
+{
+  convolve (n, dr, hk, wk, nab);
+
+  for (int i = 0; i < n; i++)
+    nab[i] = MAX (1.0 + nab[i], 1.0e-8);
+}
+
+
+/* Pair quantities on the radial grid, see bgy3d_force(): */
+static void
+pair (real beta, real dr, real damp, const Site a, const Site b, int n,
+      real u0[n], real c2[n], real fs[n], real fl[n],
+      real ul[n], real ulk[n])
+{
+  const real G = G_COULOMB_INVERSE_RANGE;
+  const real sigma = 0.5 * (a.sigma + b.sigma);
+  const real epsilon = sqrt (a.epsilon * b.epsilon);
+  const real q2 = damp * (a.charge * b.charge);
+  const real dk = M_PI / (n * dr);
+
+  for (int i = 0; i < n; i++)
+    {
+      const real r = (i + 0.5) * dr;
+
+      u0[i] = beta * lennard_jones_coulomb_short (r, sigma, epsilon, G, q2);
+      c2[i] = exp (-beta * lennard_jones_repulsive (r, epsilon, sigma));
+
+      /* Radial components of the gradients: */
+      fs[i] = lennard_jones_coulomb_short_grad (r, r, sigma, epsilon, G, q2);
+
+      /* Long-range Coulomb (1/ε₀) q² erf(Gr) / r and its derivative: */
+      const real erf_r = erf (G * r) / r;
+      ul[i] = EPSILON0INV * q2 * erf_r;
+      fl[i] = EPSILON0INV * q2 *
+        (2 * G / sqrt (M_PI) * exp (-SQR (G * r)) - erf_r) / r;
+
+      ulk[i] = coulomb_long_fourier ((i + 0.5) * dk, q2, G);
+    }
+}
+
+
+/* Tabulate on the 3D grid. Beyond the radial grid g = 1: */
+static void
+tabulate (const State *BHD, int n, real dr, const real g[n], Vec v)
+{
+  const real *L = BHD->PD->L;
+  const real rmax = sqrt (SQR (L[0]) + SQR (L[1]) + SQR (L[2])) / 2;
+  const int nt = MAX (n, (int) (rmax / dr) + 2);
+
+  real tab[nt];
+  for (int i = 0; i < nt; i++)
+    tab[i] = (i < n) ? g[i] : 1.0;
+
+  vec_rtab (BHD, nt, tab, dr, v);
+}
+
+
+void
+bgy3d_solvent_solve_radial (const ProblemData *PD,
+                            int m, const Site solvent[m],
+                            Vec g3[m][m]) /* out, allocated here */
+{
+  /* Same radial grid as the 1D RISM in hnc3d.c: */
+  const ProblemData pd = upscale (PD);
+  const int n = pd.nrad;
+  const real dr = pd.rmax / n;
+  const real beta = PD->beta;
+  const real rho = PD->rho;
+
+  bgy3d_problem_data_print (PD);
+  bgy3d_sites_show ("Solvent", m, solvent);
+
+  PRINTF ("Solving radial BGY-M %d-site equation, rmax=%g, nrad=%d...\n",
+          m, pd.rmax, n);
+
+  /* All [m][m][n] and symmetric: */
+  const size_t size = m * m * n * sizeof (real);
+  real (*g)[m][n] = malloc (size);
+  real (*hk)[m][n] = malloc (size);
+  real (*du)[m][n] = malloc (size);
+  real (*u0)[m][n] = malloc (size);
+  real (*c2)[m][n] = malloc (size);
+  real (*fs)[m][n] = malloc (size);
+  real (*fl)[m][n] = malloc (size);
+  real (*ul)[m][n] = malloc (size);
+  real (*ulk)[m][n] = malloc (size);
+  real (*psik)[m][n] = malloc (size);
+  real (*wk)[m][n] = malloc (size); /* diagonal not used */
+  real (*du_new)[m][n] = malloc (size);
+
+  /* ω(k) = sinc(kd), see omega_intra(): */
+  {
+    real d[m][m];
+    bgy3d_sites_dist_mat (m, solvent, d);
+
+    const real dk = M_PI / (n * dr);
+    for (int i = 0; i < m; i++)
+      for (int j = 0; j < m; j++)
+        for (int p = 0; p < n; p++)
+          {
+            const real kd = (p + 0.5) * dk * d[i][j];
+            wk[i][j][p] = (kd == 0.0) ? 1.0 : sin (kd) / kd;
+          }
+  }
+
+  const bool hacks = !bgy3d_getopt_test ("no-hacks");
+  const real a = PD->lambda;
+
+  for (real damp = PD->damp; damp <= 1.0; damp += 0.1)
+    {
+      const real damp_ = (damp > 0.0 ? damp : 0.0);
+
+      PRINTF ("Recomputing initial data with damping factor %f\n", damp_);
+
+      for (int i = 0; i < m; i++)
+        for (int j = 0; j < m; j++)
+          pair (beta, dr, damp_, solvent[i], solvent[j], n,
+                u0[i][j], c2[i][j], fs[i][j], fl[i][j], ul[i][j], ulk[i][j]);
+
+      /* Start each damping step from zero as the 3D code does: */
+      for (int i = 0; i < m; i++)
+        for (int j = 0; j < m; j++)
+          for (int p = 0; p < n; p++)
+            {
+              du[i][j][p] = 0.0;
+              g[i][j][p] = exp (-u0[i][j][p]);
+            }
+
+      for (int iter = 0; iter < PD->max_iter; iter++)
+        {
+          /*
+            Transforms  of h = g  - 1  and  of the  potential Ψ with ∇Ψ =
+            g ∇U.  The latter is split into the long-range Coulomb with
+            the analytic transform and the rest, (F g - F_l), that is
+            short-ranged, see Compute_dg_inter():
+          */
+          for (int i = 0; i < m; i++)
+            for (int k = 0; k < m; k++)
+              {
+                real h[n], v[n], phi[n];
+                for (int p = 0; p < n; p++)
+                  {
+                    h[p] = g[i][k][p] - 1.0;
+                    v[p] = fs[i][k][p] * g[i][k][p] + fl[i][k][p] * h[p];
+                  }
+                fourier (n, dr, h, hk[i][k]);
+
+                potential (n, dr, v, phi);
+                fourier (n, dr, phi, psik[i][k]);
+                for (int p = 0; p < n; p++)
+                  psik[i][k][p] += ulk[i][k][p];
+              }
+
+          real du_norm = 0.0;
+
+          for (int i = 0; i < m; i++)
+            for (int j = 0; j <= i; j++)
+              {
+                real *const dn = du_new[i][j];
+                real tmp[n];
+
+                /* Inter-molecular, line 1 of Eq. (4.118): */
+                for (int p = 0; p < n; p++)
+                  dn[p] = 0.0;
+
+                for (int k = 0; k < m; k++)
+                  {
+                    convolve (n, dr, psik[i][k], hk[j][k], tmp);
+                    for (int p = 0; p < n; p++)
+                      dn[p] += beta * rho * tmp[p];
+                  }
+
+                /* FIXME: 3-site code does not do this: */
+                if (hacks)
+                  for (int p = 0; p < n; p++)
+                    dn[p] *= c2[i][j][p];
+
+                for (int k = 0; k < m; k++)
+                  {
+                    /* Line 2, log-term, see bgy3d_nssa_intra_log(): */
+                    if (k != i)
+                      {
+                        real nab[n], t[n], tk[n];
+                        norm_intra (n, dr, hk[i][j], wk[k][i], nab);
+
+                        for (int p = 0; p < n; p++)
+                          t[p] = g[j][k][p] / MAX (nab[p], NORM_REG2) - 1.0;
+
+                        fourier (n, dr, t, tk);
+                        norm_intra (n, dr, tk, wk[k][i], tmp);
+
+                        for (int p = 0; p < n; p++)
+                          dn[p] -= log (tmp[p]);
+                      }
+
+                    /* Line 3, see Compute_dg_intra(): */
+                    if (k != j)
+                      {
+                        real nab[n], t[n], v[n], psi[n], chik[n], chi[n];
+
+                        /* Conditional distribution t = g / n: */
+                        norm_intra (n, dr, hk[i][j], wk[j][k], nab);
+                        for (int p = 0; p < n; p++)
+                          t[p] = g[i][k][p] / MAX (nab[p], NORM_REG2);
+
+                        /* Normalization for the division: */
+                        norm_intra (n, dr, hk[i][k], wk[j][k], nab);
+
+                        /* Potential for t ∇U, long-range split as above: */
+                        for (int p = 0; p < n; p++)
+                          v[p] = fs[i][k][p] * t[p] + fl[i][k][p] * (t[p] - 1.0);
+
+                        potential (n, dr, v, psi);
+                        fourier (n, dr, psi, chik);
+                        for (int p = 0; p < n; p++)
+                          chik[p] += ulk[i][k][p];
+
+                        /* (Ψ * ω)', divided by n, back to a potential: */
+                        convolve (n, dr, chik, wk[j][k], chi);
+                        derivative (n, dr, chi, v);
+                        for (int p = 0; p < n; p++)
+                          v[p] /= MAX (nab[p], NORM_REG);
+
+                        potential (n, dr, v, psi);
+                        for (int p = 0; p < n; p++)
+                          dn[p] += beta * psi[p];
+                      }
+                  }
+
+                /* Long-range Coulomb, scaled by inverse temperature: */
+                for (int p = 0; p < n; p++)
+                  dn[p] += beta * ul[i][j][p];
+              }
+
+          /* Mix du and du_new with a fixed ratio "a": */
+          for (int i = 0; i < m; i++)
+            for (int j = 0; j <= i; j++)
+              for (int p = 0; p < n; p++)
+                {
+                  const real d = du_new[i][j][p] - du[i][j][p];
+                  du_norm = MAX (du_norm, fabs (d));
+                  du[i][j][p] += a * d;
+                  du[j][i][p] = du[i][j][p];
+                }
+
+          /* g := exp[-(u0 + du)]: */
+          for (int i = 0; i < m; i++)
+            for (int j = 0; j < m; j++)
+              for (int p = 0; p < n; p++)
+                g[i][j][p] = exp (-(u0[i][j][p] + du[i][j][p]));
+
+          PRINTF ("%03d a=%f du=%e", iter + 1, a, du_norm);
+          for (int i = 0; i < m; i++)
+            for (int j = 0; j <= i; j++)
+              {
+                /* ρ ∫ h 4πr² dr */
+                real s = 0.0;
+                for (int p = 0; p < n; p++)
+                  s += SQR ((p + 0.5) * dr) * (g[i][j][p] - 1.0);
+                PRINTF (" h(%s-%s)=% f", solvent[i].name, solvent[j].name,
+                        rho * 4 * M_PI * dr * s);
+              }
+          PRINTF ("\n");
+
+          if (du_norm <= PD->norm_tol)
+            {
+              PRINTF ("norm %e <= %e (norm-tol) in iteration %d < %d (max-iter)\n",
+                      du_norm, PD->norm_tol, iter + 1, PD->max_iter);
+              break;
+            }
+        }
+    }
+
+  /* Text tables as read by --from-radial-g2, ji as in g01.txt: */
+  {
+    int rank;
+    MPI_Comm_rank (comm_world_petsc, &rank);
+
+    /* All workers need to know if rank 0 failed: */
+    int failed = 0;
+    if (rank == 0)
+      for (int i = 0; i < m && !failed; i++)
+        for (int j = 0; j <= i && !failed; j++)
+          {
+            char name[20];
+            snprintf (name, sizeof name, "g%d%d.txt", j, i);
+
+            FILE *fh = fopen (name, "w");
+            if (fh == NULL)
+              {
+                FPRINTF (stderr, "Can not open file %s for writing.\n", name);
+                failed = 1;
+                continue;
+              }
+            for (int p = 0; p < n; p++)
+              fprintf (fh, "%.17g %.17g\n", (p + 0.5) * dr, g[i][j][p]);
+            fclose (fh);
+          }
+
+    MPI_Bcast (&failed, 1, MPI_INT, 0, comm_world_petsc);
+    if (failed)
+      exit (1);
+  }
+
+  /* The 3D tables, same as from bgy3d_solve_solvent(): */
+  {
+    State *BHD = bgy3d_state_make (PD);
+
+    vec_create2 (BHD->da, m, g3);
+    for (int i = 0; i < m; i++)
+      for (int j = 0; j <= i; j++)
+        tabulate (BHD, n, dr, g[i][j], g3[i][j]);
+
+    bgy3d_vec_save2 ("g%d%d.bin", m, g3);
+
+    bgy3d_state_destroy (BHD);
+  }
+
+  free (g);
+  free (hk);
+  free (du);
+  free (u0);
+  free (c2);
+  free (fs);
+  free (fl);
+  free (ul);
+  free (ulk);
+  free (psik);
+  free (wk);
+  free (du_new);
+}
@@ -0,0 +1,15 @@
+/* -*- mode: c; c-basic-offset: 2; -*- vim: set sw=2 tw=70 et sta ai: */
+/*
+  Copyright (c) 2014 Alexei Matveev
+*/
+
+/*
+  Same equations and  the same output as  bgy3d_solve_solvent() but
+  solved on the radial grid (rmax, nrad). The result is written to the
+  text  files g%d%d.txt,  see --from-radial-g2, tabulated  on the 3D
+  grid and written to g%d%d.bin. Vec g[m][m] is intent(out), allocated
+  here:
+*/
+void bgy3d_solvent_solve_radial (const ProblemData *PD,
+                                 int m, const Site solvent[m],
+                                 Vec g[m][m]);
@@ -0,0 +1,431 @@
+/* -*- mode: c; c-basic-offset: 2; -*- vim: set sw=2 tw=70 et sta ai: */
+/*
+  Copyright (c) 2014 Alexei Matveev
+
+  Persistent  restart  info.  The  converged long Vec  of a solute
+  solve goes to  a binary file in the store directory. A text file
+  "index" there lists one entry per line:
+
+    fingerprint sequence n x1 y1 z1 ... xn yn zn
+
+  The fingerprint  (in hex)  hashes  everything  that  has to  agree
+  for the restart info to be usable:  the method, the grid, the
+  thermodynamic state, the closure, the solvent, the solute force
+  field and the number of workers, as the latter determines the
+  layout of the file. The solute  coordinates  are not hashed. These
+  are to find the nearest geometry. The binary  file for an entry is
+  named  by the fingerprint and the sequence number.
+
+  A resubmitted job, a scan or a  parameter sweep then starts from the
+  solution  for  the  nearest geometry  at hand  instead of from
+  zero.
+*/
+#include "bgy3d.h"
+#include "bgy3d-vec.h"          /* vec_pack_create1() */
+#include "bgy3d-solutes.h"      /* Site */
+#include "bgy3d-potential.h"    /* Context */
+#include "bgy3d-impure.h"       /* Restart */
+#include "bgy3d-restart.h"
+#include <stdint.h>             /* uint64_t */
+#include <sys/stat.h>           /* mkdir() */
+#include <errno.h>
+#include <limits.h>             /* PATH_MAX */
+
+
+/* Two geometries closer than that, RMS in A, are the same entry: */
+#define SAME_GEOMETRY 1.0e-6
+
+
+/* FNV-1a, folds len bytes into *h: */
+static void
+hash (uint64_t *h, size_t len, const void *data)
+{
+  const unsigned char *p = data;
+
+  for (size_t i = 0; i < len; i++)
+    {
+      *h ^= p[i];
+      *h *= 1099511628211ULL;
+    }
+}
+
+
+static uint64_t
+fingerprint (const char method[], const ProblemData *PD,
+             int m, const Site solvent[m],
+             int n, const Site solute[n])
+{
+  uint64_t h = 14695981039346656037ULL;
+
+  hash (&h, strlen (method), method);
+
+  int np;
+  MPI_Comm_size (comm_world_petsc, &np);
+  hash (&h, sizeof np, &np);
+
+  hash (&h, sizeof PD->N, PD->N);
+  hash (&h, sizeof PD->L, PD->L);
+  hash (&h, sizeof PD->beta, &PD->beta);
+  hash (&h, sizeof PD->rho, &PD->rho);
+  hash (&h, sizeof PD->closure, &PD->closure);
+
+  /* Site names may have garbage after the terminating zero: */
+  void site (const Site *s, bool coords)
+  {
+    const char *end = memchr (s->name, '\0', sizeof s->name);
+    hash (&h, end ? (size_t) (end - s->name) : sizeof s->name, s->name);
+    hash (&h, sizeof s->sigma, &s->sigma);
+    hash (&h, sizeof s->epsilon, &s->epsilon);
+    hash (&h, sizeof s->charge, &s->charge);
+    if (coords)
+      hash (&h, sizeof s->x, s->x);
+  }
+
+  /* Solvent geometry is part of the model: */
+  hash (&h, sizeof m, &m);
+  for (int i = 0; i < m; i++)
+    site (&solvent[i], true);
+
+  hash (&h, sizeof n, &n);
+  for (int i = 0; i < n; i++)
+    site (&solute[i], false);
+
+  return h;
+}
+
+
+/*
+  Scans the  index for entries with this fingerprint.  Returns the
+  sequence number of the entry nearest to the solute geometry, or -1.
+  The RMS deviation goes to *dist.  The next free sequence number goes
+  to *next:
+*/
+static int
+scan (const char dir[], uint64_t fp, int n, const Site solute[n],
+      real *dist, int *next)
+{
+  char path[PATH_MAX];
+  snprintf (path, sizeof path, "%s/index", dir);
+
+  int best = -1;
+  *dist = INFINITY;
+  *next = 0;
+
+  FILE *fh = fopen (path, "r");
+  if (fh == NULL)
+    return best;
+
+  unsigned long long key;
+  int seq, k;
+  while (fscanf (fh, "%llx %d %d", &key, &seq, &k) == 3)
+    {
+      /* Always consume the coordinates: */
+      real sum = 0.0;
+      bool ok = true;
+      for (int i = 0; i < k; i++)
+        for (int j = 0; j < 3; j++)
+          {
+            double x;
+            if (fscanf (fh, "%lf", &x) != 1)
+              ok = false;
+            else if (k == n)
+              sum += SQR (x - solute[i].x[j]);
+          }
+
+      if (!ok)
+        break;                  /* truncated line */
+
+      if (key != fp || k != n)
+        continue;
+
+      if (seq >= *next)
+        *next = seq + 1;
+
+      const real rms = sqrt (sum / (n > 0 ? n : 1));
+      if (rms < *dist)
+        {
+          *dist = rms;
+          best = seq;
+        }
+    }
+
+  fclose (fh);
+
+  return best;
+}
+
+
+static void
+entry_path (const char dir[], uint64_t fp, int seq, int len, char path[len])
+{
+  snprintf (path, len, "%s/%016llx-%d.bin", dir,
+            (unsigned long long) fp, seq);
+}
+
+
+Restart*
+bgy3d_restart_load (const char dir[], const char method[],
+                    const ProblemData *PD,
+                    int m, const Site solvent[m],
+                    int n, const Site solute[n])
+{
+  const uint64_t fp = fingerprint (method, PD, m, solvent, n, solute);
+
+  /* Every worker reads the same index and comes to the same result: */
+  real dist;
+  int next;
+  const int seq = scan (dir, fp, n, solute, &dist, &next);
+
+  if (seq < 0)
+    return NULL;
+
+  char path[PATH_MAX];
+  entry_path (dir, fp, seq, sizeof path, path);
+
+  PRINTF ("# Restart from %s, RMS distance %g A\n", path, dist);
+
+  /*
+    The restart info is packed the same way as by the solvers. The
+    State is needed for the layout only. With the pool in bgy3d.c the
+    solver will get the same descriptors again:
+  */
+  State *BHD = bgy3d_state_make (PD);
+
+  Vec U = vec_pack_create1 (BHD->da, m);
+  bgy3d_vec_read (path, U);
+
+  bgy3d_state_destroy (BHD);
+
+  return (void*) U;
+}
+
+
+void
+bgy3d_restart_save (const char dir[], const char method[],
+                    const ProblemData *PD,
+                    int m, const Site solvent[m],
+                    int n, const Site solute[n],
+                    const Restart *restart)
+{
+  assert (restart != NULL);
+
+  const uint64_t fp = fingerprint (method, PD, m, solvent, n, solute);
+
+  int rank;
+  MPI_Comm_rank (comm_world_petsc, &rank);
+
+  if (rank == 0)
+    if (mkdir (dir, 0777) && errno != EEXIST)
+      FPRINTF (stderr, "Warning: failed to create %s\n", dir);
+
+  /* Make sure nobody looks into the index before it is there: */
+  MPI_Barrier (comm_world_petsc);
+
+  /* Overwrite the entry for the same geometry, if any: */
+  real dist;
+  int next;
+  int seq = scan (dir, fp, n, solute, &dist, &next);
+  const bool fresh = !(seq >= 0 && dist < SAME_GEOMETRY);
+  if (fresh)
+    seq = next;
+
+  char path[PATH_MAX];
+  entry_path (dir, fp, seq, sizeof path, path);
+
+  /* Collective. Restart info is just a long Vec: */
+  bgy3d_vec_save (path, (Vec) restart);
+
+  /* The data goes first, the index entry  last. A single line appended
+     at once: */
+  if (fresh && rank == 0)
+    {
+      char index[PATH_MAX];
+      snprintf (index, sizeof index, "%s/index", dir);
+
+      FILE *fh = fopen (index, "a");
+      if (fh)
+        {
+          fprintf (fh, "%016llx %d %d", (unsigned long long) fp, seq, n);
+          for (int i = 0; i < n; i++)
+            fprintf (fh, " %.17g %.17g %.17g",
+                     solute[i].x[0], solute[i].x[1], solute[i].x[2]);
+          fprintf (fh, "\n");
+          fclose (fh);
+        }
+      else
+        FPRINTF (stderr, "Warning: failed to update %s\n", index);
+    }
+
+  MPI_Barrier (comm_world_petsc);
+}
+
+
+/*
+  Extrapolation along  a path.   The last few converged  results are
+  kept in memory  together with the solute geometries.  Geometries of
+  a scan, a PMF or an optimization follow a smooth path.  With the
+  path  coordinate  s  the arc length  through  the  stored  geometries,
+  the  new point  at s  =  s₀  +  |x -  x₀|  beyond  the newest one
+  (s₀), the prediction is the Lagrange polynomial through the stored
+  results evaluated at s.   For equal steps  and three points that is
+  the familiar 3 T₀ - 3 T₁ + T₂.
+
+  The history is reset  whenever  the fingerprint changes. Points
+  that do not move away from the path fall back to no prediction:
+*/
+#define MAX_HISTORY 3
+
+static struct
+{
+  uint64_t fp;
+  int size;                     /* newest first */
+  int n;
+  real (*x[MAX_HISTORY])[3];    /* [n][3] */
+  Vec T[MAX_HISTORY];           /* packed as by vec_pack_create1() */
+} history = {.size = 0};
+
+
+/* Also run by exit(), before PetscFinalize(): */
+static void
+history_clear (void)
+{
+  for (int k = 0; k < history.size; k++)
+    {
+      free (history.x[k]);
+      vec_pack_destroy1 (&history.T[k]);
+    }
+  history.size = 0;
+}
+
+
+/* New Vec of the same layout, in the form bgy3d_restart_destroy()
+   expects: */
+static Vec
+pack_duplicate (const Vec x)
+{
+  const int n = vec_local_size (x);
+
+  return vec_from_array (n, malloc (n * sizeof (real)));
+}
+
+
+static real
+distance (int n, real x[n][3], real y[n][3])
+{
+  real sum = 0.0;
+  for (int i = 0; i < n; i++)
+    FOR_DIM
+      sum += SQR (x[i][dim] - y[i][dim]);
+
+  return sqrt (sum);
+}
+
+
+void
+bgy3d_restart_remember (const char method[], const ProblemData *PD,
+                        int m, const Site solvent[m],
+                        int n, const Site solute[n],
+                        const Restart *restart)
+{
+  assert (restart != NULL);
+
+  const uint64_t fp = fingerprint (method, PD, m, solvent, n, solute);
+
+  static bool registered = false;
+  if (!registered)
+    {
+      atexit (history_clear);
+      registered = true;
+    }
+
+  if (history.size > 0 && history.fp != fp)
+    history_clear ();
+
+  history.fp = fp;
+  history.n = n;
+
+  /* Drop the oldest one if full: */
+  if (history.size == MAX_HISTORY)
+    {
+      history.size--;
+      free (history.x[history.size]);
+      vec_pack_destroy1 (&history.T[history.size]);
+    }
+
+  for (int k = history.size; k > 0; k--)
+    {
+      history.x[k] = history.x[k - 1];
+      history.T[k] = history.T[k - 1];
+    }
+  history.size++;
+
+  real (*x)[3] = malloc (n * sizeof *x);
+  for (int i = 0; i < n; i++)
+    FOR_DIM
+      x[i][dim] = solute[i].x[dim];
+
+  history.x[0] = x;
+  history.T[0] = pack_duplicate ((Vec) restart);
+  VecCopy ((Vec) restart, history.T[0]);
+}
+
+
+Restart*
+bgy3d_restart_predict (int order, const char method[], const ProblemData *PD,
+                       int m, const Site solvent[m],
+                       int n, const Site solute[n])
+{
+  const uint64_t fp = fingerprint (method, PD, m, solvent, n, solute);
+
+  /* Order p needs p + 1 points: */
+  const int np = (order + 1 < history.size ? order + 1 : history.size);
+
+  if (history.fp != fp || np < 2)
+    return NULL;
+
+  real x[n][3];
+  for (int i = 0; i < n; i++)
+    FOR_DIM
+      x[i][dim] = solute[i].x[dim];
+
+  /* Path coordinates, the newest stored point at zero: */
+  real s[np];
+  s[0] = 0.0;
+  for (int k = 1; k < np; k++)
+    s[k] = s[k - 1] - distance (n, history.x[k - 1], history.x[k]);
+
+  const real step = distance (n, x, history.x[0]);
+
+  /*
+    Only extrapolate  forward and not  too far. A point  closer  to the
+    older one  than to the  newest, a repeated point or a jump of more
+    than twice the last step are better served without prediction:
+  */
+  const real last = -s[1];
+  if (step == 0.0 || last == 0.0 || step > 2 * last ||
+      distance (n, x, history.x[1]) < step)
+    return NULL;
+
+  /* Lagrange weights at s = step: */
+  real w[np];
+  for (int k = 0; k < np; k++)
+    {
+      w[k] = 1.0;
+      for (int j = 0; j < np; j++)
+        if (j != k)
+          {
+            /* Coincident path points, give up: */
+            if (s[k] == s[j])
+              return NULL;
+            w[k] *= (step - s[j]) / (s[k] - s[j]);
+          }
+    }
+
+  Vec T = pack_duplicate (history.T[0]);
+  VecSet (T, 0.0);
+  VecMAXPY (T, np, w, history.T);
+
+  PRINTF ("# Restart extrapolated from %d points, step %g A\n", np, step);
+
+  return (void*) T;
+}
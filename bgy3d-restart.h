@@ -0,0 +1,51 @@
+/* -*- mode: c; c-basic-offset: 2; -*- vim: set sw=2 tw=70 et sta ai: */
+/*
+  Copyright (c) 2014 Alexei Matveev
+*/
+
+/*
+  On-disk store of  restart info in the directory dir.  Entries are
+  tagged by  the method, e.g.  "hnc" or "bgy", and a fingerprint of
+  the problem data, the solvent, the solute  force field and the
+  number of workers.  Different geometries of the same solute are
+  different entries.
+
+  Collective.  Returns a new Restart* for the stored geometry nearest
+  to the solute, or NULL if there is no matching entry:
+*/
+Restart* bgy3d_restart_load (const char dir[], const char method[],
+                             const ProblemData *PD,
+                             int m, const Site solvent[m],
+                             int n, const Site solute[n]);
+
+/*
+  Collective. Adds  restart info of m  sites for this geometry, or
+  replaces the entry for the same geometry:
+*/
+void bgy3d_restart_save (const char dir[], const char method[],
+                         const ProblemData *PD,
+                         int m, const Site solvent[m],
+                         int n, const Site solute[n],
+                         const Restart *restart);
+
+
+/*
+  Collective.  Keeps a  copy of the  converged restart info for this
+  geometry in  memory. Up to three  most recent points of the same
+  problem are kept:
+*/
+void bgy3d_restart_remember (const char method[], const ProblemData *PD,
+                             int m, const Site solvent[m],
+                             int n, const Site solute[n],
+                             const Restart *restart);
+
+/*
+  Collective. Extrapolates the remembered restart info to the solute
+  geometry by a polynomial of  the given order (1 or 2) in the path
+  coordinate.  Returns a new Restart* or NULL if there are fewer than
+  two remembered points or the geometry is not a step along the path:
+*/
+Restart* bgy3d_restart_predict (int order, const char method[],
+                                const ProblemData *PD,
+                                int m, const Site solvent[m],
+                                int n, const Site solute[n]);
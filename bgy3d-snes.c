@@ -15,18 +15,29 @@
 
 void bgy3d_snes_default (const ProblemData *PD, void *ctx,
                          VecFunc1 F, VecFunc2 dF, Vec x)
+{
+  bgy3d_snes_default_pc (PD, ctx, F, dF, NULL, x);
+}
+
+
+/* Same  as bgy3d_snes_default() with  an optional  preconditioner P,
+   only used by Newton: */
+void bgy3d_snes_default_pc (const ProblemData *PD, void *ctx,
+                            VecFunc1 F, VecFunc2 dF, VecFunc2 P, Vec x)
 {
   char solver[20] = "newton";
   bgy3d_getopt_string ("snes-solver", sizeof solver, solver);
 
   if (strcmp (solver, "newton") == 0)
-    bgy3d_snes_newton (PD, ctx, F, dF, x);
+    bgy3d_snes_newton_pc (PD, ctx, F, dF, P, x);
   else if (strcmp (solver, "picard") == 0)
     bgy3d_snes_picard (PD, ctx, F, dF, x);
   else if (strcmp (solver, "jager") == 0)
     bgy3d_snes_jager (PD, ctx, F, dF, x);
   else if (strcmp (solver, "trial") == 0)
     bgy3d_snes_trial (PD, ctx, F, dF, x);
+  else if (strcmp (solver, "mdiis") == 0)
+    bgy3d_snes_mdiis (PD, ctx, F, dF, x);
   else
     {
       PRINTF ("No such SNES solver: %s\n", solver);
@@ -150,16 +161,77 @@ jupdate (SNES snes, Vec r, Mat *J, Mat *B, MatStructure *s, void *data)
 
 
 
+/*
+  User  preconditioner P(r) for J(r) as  a PCSHELL.  Shares the point r
+  with the Jacobian J(r), see jcreate(). The PC is set up each time r
+  changes, that is P is called with  dx == NULL then.
+*/
+typedef struct Pre
+{
+  const Ctx *J;                 /* owned by the Jacobian Mat */
+  VecFunc2 p;
+} Pre;
+
+
+/* [Setup] Prepare P(r) for the new r: */
+static PetscErrorCode
+psetup (PC pc)
+{
+  Pre *pre;
+  PCShellGetContext (pc, (void**) &pre);
+
+  pre->p (pre->J->data, pre->J->r, NULL, NULL);
+  return 0;
+}
+
+
+/* [Operation] Apply P(r): */
+static PetscErrorCode
+papply (PC pc, Vec x, Vec y)
+{
+  Pre *pre;
+  PCShellGetContext (pc, (void**) &pre);
+
+  /* y = P(r) * x */
+  pre->p (pre->J->data, pre->J->r, x, y);
+  return 0;
+}
+
+
+/* [Destructor] */
+static PetscErrorCode
+pdestroy (PC pc)
+{
+  Pre *pre;
+  PCShellGetContext (pc, (void**) &pre);
+
+  free (pre);                   /* malloc() in bgy3d_snes_newton_pc() */
+  return 0;
+}
+
+
+void
+bgy3d_snes_newton (const ProblemData *PD, void *ctx,
+                   VecFunc1 F, VecFunc2 dF, Vec x)
+{
+  bgy3d_snes_newton_pc (PD, ctx, F, dF, NULL, x);
+}
+
+
 /*
   For solving HNC equation with Newton. Except of x everything else in
   the  closure context is  considered read  only input  or intemediate
   terms depending  on x.  That  is when looking for  total correlation
   function h, the direct correlation function should be fixed (or be a
   function of h).
+
+  The preconditioner P, if not NULL, applies an approximate inverse
+  of the Jacobian dF. It is only used with --snes-pc kspace, the
+  default is no preconditioning.
 */
 void
-bgy3d_snes_newton (const ProblemData *PD, void *ctx,
-                   VecFunc1 F, VecFunc2 dF, Vec x)
+bgy3d_snes_newton_pc (const ProblemData *PD, void *ctx,
+                      VecFunc1 F, VecFunc2 dF, VecFunc2 P, Vec x)
 {
   /* Create the snes environment */
   SNES snes;
@@ -168,6 +240,9 @@ bgy3d_snes_newton (const ProblemData *PD, void *ctx,
   /* SNES needs a place to store residual: */
   local Vec r = vec_duplicate (x);
 
+  /* Self-made Jacobian, if any. Not a ref, SNES owns it: */
+  Mat jac = NULL;
+
   /* SNES form-functions should obey this interface: */
   PetscErrorCode F1 (SNES snes, Vec x, Vec r, void *ctx)
   {
@@ -193,6 +268,9 @@ bgy3d_snes_newton (const ProblemData *PD, void *ctx,
       /* Stuck it into SNES object: */
       SNESSetJacobian (snes, J, J, jupdate, ctx);
 
+      /* The PC shares the point r0 with J, see below: */
+      jac = J;
+
       /* Both  Mat  J  and  SNES  snes  should  have  incremented  the
          refcounts: */
       mat_destroy (&J);
@@ -303,7 +381,36 @@ bgy3d_snes_newton (const ProblemData *PD, void *ctx,
     KSPGetPC (ksp, &pc);
 
     /* set preconditioner: PCLU, PCNONE, PCJACOBI... */
-    PCSetType (pc, PCNONE);
+    char type[20] = "none";
+    bgy3d_getopt_string ("snes-pc", sizeof type, type);
+
+    if (strcmp (type, "none") == 0)
+      PCSetType (pc, PCNONE);
+    else if (strcmp (type, "kspace") == 0)
+      {
+        if (P && jac)
+          {
+            Pre *pre = malloc (sizeof *pre); /* free() in pdestroy() */
+            *pre = (Pre) {mat_shell_context (jac), P};
+
+            PCSetType (pc, PCSHELL);
+            PCShellSetContext (pc, pre);
+            PCShellSetSetUp (pc, psetup);
+            PCShellSetApply (pc, papply);
+            PCShellSetDestroy (pc, pdestroy);
+            PCShellSetName (pc, "kspace");
+          }
+        else
+          {
+            FPRINTF (stderr, "bgy3d_snes_newton: Warning: no preconditioner here!\n");
+            PCSetType (pc, PCNONE);
+          }
+      }
+    else
+      {
+        PRINTF ("No such SNES preconditioner: %s\n", type);
+        exit (1);
+      }
   }
 
   /*
@@ -384,6 +491,238 @@ void bgy3d_snes_picard (const ProblemData *PD, void *ctx,
 }
 
 
+/*
+  Solve A x =  b for small dense A  by Gauss elimination with partial
+  pivoting. Both A and b are destroyed, the  result is returned in b.
+  False if A is (numerically) singular:
+*/
+static bool
+small_solve (int n, real a[n][n], real b[n])
+{
+  for (int p = 0; p < n; p++)
+    {
+      int q = p;
+      for (int i = p + 1; i < n; i++)
+        if (fabs (a[i][p]) > fabs (a[q][p]))
+          q = i;
+
+      if (fabs (a[q][p]) < 1.0e-14)
+        return false;
+
+      for (int j = 0; j < n; j++)
+        {
+          const real t = a[p][j];
+          a[p][j] = a[q][j];
+          a[q][j] = t;
+        }
+      {
+        const real t = b[p];
+        b[p] = b[q];
+        b[q] = t;
+      }
+
+      for (int i = p + 1; i < n; i++)
+        {
+          const real f = a[i][p] / a[p][p];
+          for (int j = p; j < n; j++)
+            a[i][j] -= f * a[p][j];
+          b[i] -= f * b[p];
+        }
+    }
+
+  for (int i = n - 1; i >= 0; i--)
+    {
+      for (int j = i + 1; j < n; j++)
+        b[i] -= a[i][j] * b[j];
+      b[i] /= a[i][i];
+    }
+  return true;
+}
+
+
+/*
+  Modified  direct  inversion  in the  iterative  subspace  (MDIIS) as
+  used for  RISM by Kovalenko et al., aka Anderson mixing.  Keeps the
+  last  few iterates  x  and  their residuals  r  = F(x)  and  looks
+  for the  combination with the  smallest residual
+
+    r' = Σ  c  r ,  Σ  c  = 1
+         i   i  i   i   i
+
+  by solving the  small bordered system of the  overlaps <r |r >.  The
+  next iterate is then
+
+    x = Σ  c  x  + λ r'
+        i   i  i
+
+  with the  mixing parameter λ  of Picard iterations.   The subspace
+  size is --mdiis-size. When the  residual norm exceeds  the smallest
+  one in the  subspace by the factor  --mdiis-restart  the subspace is
+  restarted from the best iterate.
+*/
+void bgy3d_snes_mdiis (const ProblemData *PD, void *ctx,
+                       VecFunc1 F, VecFunc2 dF, Vec x)
+{
+  if (dF)
+    FPRINTF (stderr, "bgy3d_snes_mdiis: Warning: not using Jacobian!\n");
+
+  /* Mixing parameter */
+  const real lambda = PD->lambda;
+
+  /* Number of total iterations */
+  const int max_iter = PD->max_iter;
+
+  /* Convergence threshold: */
+  const real norm_tol = PD->norm_tol;
+
+  int size = 5;
+  bgy3d_getopt_int ("mdiis-size", &size);
+  assert (size > 0);
+
+  real restart = 10.0;
+  bgy3d_getopt_real ("mdiis-restart", &restart);
+
+  /* Iterates and residuals, slots of the ring buffer: */
+  Vec xs[size], rs[size];
+  for (int s = 0; s < size; s++)
+    {
+      xs[s] = vec_duplicate (x);
+      rs[s] = vec_duplicate (x);
+    }
+
+  /* Overlaps  <r |r > by  slot  and  residual norms.  The k active
+     slots from the oldest to the newest are in act[]: */
+  real B[size][size], norm[size];
+  int act[size];
+  int k = 0;
+
+  for (int iter = 0; iter < max_iter; iter++)
+    {
+      /* Free slot, maybe the oldest one: */
+      int s;
+      if (k < size)
+        {
+          /* Slots are all different, find one not in use: */
+          bool used[size];
+          for (int i = 0; i < size; i++)
+            used[i] = false;
+          for (int i = 0; i < k; i++)
+            used[act[i]] = true;
+
+          s = 0;
+          while (used[s])
+            s++;
+        }
+      else
+        {
+          s = act[0];
+          for (int i = 1; i < k; i++)
+            act[i - 1] = act[i];
+          k--;
+        }
+      act[k++] = s;
+
+      VecCopy (x, xs[s]);
+      F (ctx, x, rs[s]);
+
+      /* New row and column of the overlap matrix: */
+      {
+        Vec ra[k];
+        real dot[k];
+        for (int i = 0; i < k; i++)
+          ra[i] = rs[act[i]];
+
+        VecMDot (rs[s], k, ra, dot);
+
+        for (int i = 0; i < k; i++)
+          B[s][act[i]] = B[act[i]][s] = dot[i];
+      }
+
+      /* Same infinity norm as Picard and Jager compare to --norm-tol: */
+      norm[s] = vec_norm (rs[s]);
+
+      if (verbosity > 0)
+        PRINTF (" # %03d: norm of difference: %e\t%f\t%d\n",
+                iter + 1, norm[s], lambda, k);
+
+      if (norm[s] < norm_tol)
+        break;
+
+      /* Restart from the best iterate if this one is much worse: */
+      {
+        int best = s;
+        for (int i = 0; i < k; i++)
+          if (norm[act[i]] < norm[best])
+            best = act[i];
+
+        if (norm[s] > restart * norm[best])
+          {
+            act[0] = best;
+            k = 1;
+          }
+      }
+
+      /*
+        Bordered  system for the coefficients c and the multiplier l,
+        with the overlaps scaled by the  newest one for conditioning:
+
+          | B    -1 | | c |   |  0 |
+          |         | |   | = |    |
+          | -1    0 | | l |   | -1 |
+
+        Drop the oldest iterates as long as it is singular:
+      */
+      real c[k + 1];
+      for (;;)
+        {
+          const int n = k + 1;
+          real a[n][n];
+
+          const real scale = B[act[k - 1]][act[k - 1]];
+          for (int i = 0; i < k; i++)
+            {
+              for (int j = 0; j < k; j++)
+                a[i][j] = B[act[i]][act[j]] / scale;
+              a[i][k] = a[k][i] = -1.0;
+              c[i] = 0.0;
+            }
+          a[k][k] = 0.0;
+          c[k] = -1.0;
+
+          if (small_solve (n, a, c))
+            break;
+
+          assert (k > 1);     /* 1x1 case is never singular */
+          for (int i = 1; i < k; i++)
+            act[i - 1] = act[i];
+          k--;
+        }
+
+      /* x = Σ c  x  + λ Σ c  r : */
+      {
+        Vec xa[k], ra[k];
+        real lc[k];
+        for (int i = 0; i < k; i++)
+          {
+            xa[i] = xs[act[i]];
+            ra[i] = rs[act[i]];
+            lc[i] = lambda * c[i];
+          }
+
+        VecSet (x, 0.0);
+        VecMAXPY (x, k, c, xa);
+        VecMAXPY (x, k, lc, ra);
+      }
+    }
+
+  for (int s = 0; s < size; s++)
+    {
+      vec_destroy (&xs[s]);
+      vec_destroy (&rs[s]);
+    }
+}
+
+
 void bgy3d_snes_trial (const ProblemData *PD, void *ctx,
                        VecFunc1 F, VecFunc2 dF, Vec x)
 {
@@ -593,6 +932,188 @@ bgy3d_krylov (void *ctx, VecFunc1 F, Vec b, Vec x)
 }
 
 
+/*
+  For solving  linear equations F x[s] =  b[s] for s = 0,  ..., k - 1
+  iteratively.  These are k GMRES(r)  iterations running in lockstep,
+  so that each step applies F  to the Krylov directions of all systems
+  still  iterating in one call.  The caller may  then share the setup
+  and  batch the FFTs.   Vectors  of the  converged systems  drop out.
+  Classical  Gram-Schmidt and Givens  rotations,  same as  the default
+  KSP.  All norms are  2-norms, the Arnoldi vectors have unit length.
+  Convergence is declared  for the relative residual rtol / 1000 as by
+  ksp_create(), with PETSc defaults.  On entry x[] is the initial
+  guess:
+*/
+void
+bgy3d_krylov_many (void *ctx, VecFuncN F, int k, Vec b[k], Vec x[k])
+{
+  const int r = 30;             /* restart, as KSPGMRES */
+  const int maxit = 1000;       /* maxits / 10 */
+  const real rtol = 1.0e-8;     /* rtol / 1000 */
+
+  real bnorm[k];
+  bool done[k];
+  int its[k];
+  for (int s = 0; s < k; s++)
+    {
+      bnorm[s] = vec_norm2 (b[s]);
+      done[s] = false;
+      its[s] = 0;
+
+      if (bnorm[s] == 0.0)
+        {
+          VecSet (x[s], 0.0);
+          done[s] = true;
+        }
+    }
+
+  /* Krylov bases, Hessenberg matrices and rotations: */
+  Vec V[k][r + 1];
+  real H[k][r + 1][r], g[k][r + 1], cs[k][r], sn[k][r];
+  for (int s = 0; s < k; s++)
+    for (int i = 0; i <= r; i++)
+      V[s][i] = vec_duplicate (b[s]);
+
+  for (;;)
+    {
+      /* Systems in this restart cycle: */
+      int act[k], na = 0;
+      for (int s = 0; s < k; s++)
+        if (!done[s])
+          act[na++] = s;
+
+      if (na == 0)
+        break;
+
+      /* True residuals V[0] = b - F x for all of them in one call: */
+      {
+        Vec xa[na], va[na];
+        for (int a = 0; a < na; a++)
+          {
+            xa[a] = x[act[a]];
+            va[a] = V[act[a]][0];
+          }
+        F (ctx, na, xa, va);
+      }
+
+      int nj[k];                /* cycle length */
+      bool inner[k];
+      for (int a = 0; a < na; a++)
+        {
+          const int s = act[a];
+
+          VecAYPX (V[s][0], -1.0, b[s]);
+          const real beta = vec_norm2 (V[s][0]);
+
+          nj[s] = 0;
+          inner[s] = !(beta <= rtol * bnorm[s] || its[s] >= maxit);
+          if (!inner[s])
+            {
+              done[s] = true;
+              continue;
+            }
+
+          VecScale (V[s][0], 1.0 / beta);
+          g[s][0] = beta;
+        }
+
+      for (int j = 0; j < r; j++)
+        {
+          int ni = 0;
+          Vec va[na], wa[na];
+          for (int a = 0; a < na; a++)
+            if (inner[act[a]])
+              {
+                va[ni] = V[act[a]][j];
+                wa[ni] = V[act[a]][j + 1];
+                ni++;
+              }
+
+          if (ni == 0)
+            break;
+
+          /* w = F v  for all systems still in the cycle: */
+          F (ctx, ni, va, wa);
+
+          for (int a = 0; a < na; a++)
+            {
+              const int s = act[a];
+              if (!inner[s])
+                continue;
+
+              Vec w = V[s][j + 1];
+
+              /* Orthogonalize w against V[0:j]: */
+              real h[j + 2];
+              VecMDot (w, j + 1, V[s], h);
+              for (int i = 0; i <= j; i++)
+                h[i] = -h[i];
+              VecMAXPY (w, j + 1, h, V[s]);
+              for (int i = 0; i <= j; i++)
+                h[i] = -h[i];
+              h[j + 1] = vec_norm2 (w);
+
+              /* Previous rotations, then a new one for h[j + 1]: */
+              for (int i = 0; i < j; i++)
+                {
+                  const real t = cs[s][i] * h[i] + sn[s][i] * h[i + 1];
+                  h[i + 1] = -sn[s][i] * h[i] + cs[s][i] * h[i + 1];
+                  h[i] = t;
+                }
+              const real d = sqrt (SQR (h[j]) + SQR (h[j + 1]));
+              cs[s][j] = (d > 0.0 ? h[j] / d : 1.0);
+              sn[s][j] = (d > 0.0 ? h[j + 1] / d : 0.0);
+
+              if (h[j + 1] > 0.0)
+                VecScale (w, 1.0 / h[j + 1]);
+
+              h[j] = d;
+              g[s][j + 1] = -sn[s][j] * g[s][j];
+              g[s][j] = cs[s][j] * g[s][j];
+
+              for (int i = 0; i <= j; i++)
+                H[s][i][j] = h[i];
+
+              nj[s] = j + 1;
+              its[s]++;
+
+              /* Residual estimate |g[j + 1]|, or breakdown: */
+              if (fabs (g[s][j + 1]) <= rtol * bnorm[s] ||
+                  its[s] >= maxit || d == 0.0)
+                inner[s] = false;
+            }
+        }
+
+      /* x += V y with H y = g, upper triangular: */
+      for (int a = 0; a < na; a++)
+        {
+          const int s = act[a];
+          const int n = nj[s];
+          if (n == 0)
+            continue;
+
+          real y[n];
+          for (int i = n - 1; i >= 0; i--)
+            {
+              real t = g[s][i];
+              for (int l = i + 1; l < n; l++)
+                t -= H[s][i][l] * y[l];
+              y[i] = (H[s][i][i] != 0.0 ? t / H[s][i][i] : 0.0);
+            }
+          VecMAXPY (x[s], n, y, V[s]);
+        }
+    }
+
+  if (verbosity > 0)
+    for (int s = 0; s < k; s++)
+      PRINTF ("ksp[%d](%2d) ", s, its[s]);
+
+  for (int s = 0; s < k; s++)
+    for (int i = 0; i <= r; i++)
+      vec_destroy (&V[s][i]);
+}
+
+
 /*
   Assumes f(x) is linear and solves for f(x) = b.
 
@@ -25,6 +25,9 @@ typedef void (*VecFunc1) (void *ctx, Vec x, Vec r /* out */);
 /* A function to apply Jacobian: r = J(x) * dx */
 typedef void (*VecFunc2) (void *ctx, Vec x, Vec dx, Vec r /* out */);
 
+/* Same as VecFunc1 for k inputs at once: */
+typedef void (*VecFuncN) (void *ctx, int k, Vec x[k], Vec r[k] /* out */);
+
 /*
   Solvers for  non-linear equations, either Newton  or fixpoint Picard
   iterations.
@@ -40,6 +43,9 @@ void rism_snes (void *ctx, ArrFunc1 f, ArrFunc2 df, int n, real x_[n]);
 /* For solving linear equation F(x) = b iteratively. */
 void bgy3d_krylov (void *ctx, VecFunc1 F, Vec b, Vec x);
 
+/* Same for  k right hand sides, F applied to all of them at once: */
+void bgy3d_krylov_many (void *ctx, VecFuncN F, int k, Vec b[k], Vec x[k]);
+
 /* Solves for f(x) = b  iteratively. Has to be consistent with Fortran
    declarations in snes.f90: */
 void rism_krylov (void *ctx, ArrFunc1 f, int n, real b_[n], real x_[n]);
@@ -55,6 +61,17 @@ void bgy3d_snes_default (const ProblemData *PD, void *ctx,
 void bgy3d_snes_newton (const ProblemData *PD, void *ctx,
                         VecFunc1 F, VecFunc2 dF, Vec x);
 
+/*
+  Same with a  preconditioner P, P(x) * dx approximates the inverse of
+  the Jacobian J(x) * dx.  P is called  with dx  == NULL to set up at
+  x, whenever x changes. Eventually used by Newton, see --snes-pc:
+*/
+void bgy3d_snes_default_pc (const ProblemData *PD, void *ctx,
+                            VecFunc1 F, VecFunc2 dF, VecFunc2 P, Vec x);
+
+void bgy3d_snes_newton_pc (const ProblemData *PD, void *ctx,
+                           VecFunc1 F, VecFunc2 dF, VecFunc2 P, Vec x);
+
 void bgy3d_snes_picard (const ProblemData *PD, void *ctx,
                         VecFunc1 F, VecFunc2 dF, Vec x);
 
@@ -63,3 +80,6 @@ void bgy3d_snes_jager (const ProblemData *PD, void *ctx,
 
 void bgy3d_snes_trial (const ProblemData *PD, void *ctx,
                        VecFunc1 F, VecFunc2 dF, Vec x);
+
+void bgy3d_snes_mdiis (const ProblemData *PD, void *ctx,
+                       VecFunc1 F, VecFunc2 dF, Vec x);
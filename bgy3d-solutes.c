@@ -349,13 +349,15 @@ field0 (const State *BHD, const Site *a,
   /*
     Compute the field  at all grid points  (x, y, z) <-> (i,  j, k) by
     summing LJ  and short range Coulomb contributions  from all solute
-    sites at each grid point.
+    sites at each grid point.  A row of grid points at a time with the
+    sites in the outer loop:
   */
-  real f3 (const real x[3])
+  void f (int np, const real x[np][3], real e[np])
   {
-    /* Sum force field contribution from all solute sites: */
-    real e = 0.0;
+    for (int p = 0; p < np; p++)
+      e[p] = 0.0;
 
+    /* Sum force field contribution from all solute sites: */
     for (int i = 0; i < n; i++)
       {
         const Site *b = &solute[i]; /* shorter alias */
@@ -365,23 +367,265 @@ field0 (const State *BHD, const Site *a,
         const real sab = 0.5 * (a->sigma + b->sigma);
         const real qab = a->charge * b->charge * EPSILON0INV;
 
-        /* Distance from a grid point to this site: */
-        const real rab = distance (x, b->x);
+        for (int p = 0; p < np; p++)
+          {
+            /* Distance from a grid point to this site: */
+            const real rab = distance (x[p], b->x);
 
-        /* Lennard-Jones + Coulomb, short range part: */
-        e += eab * ljcap0 (rab / sab) + qab * G * cscap0 (G * rab);
+            /* Lennard-Jones + Coulomb, short range part: */
+            e[p] += eab * ljcap0 (rab / sab) + qab * G * cscap0 (G * rab);
+          }
       }
-    return e;
   }
-  vec_rmap3 (BHD, f3, v);
+  vec_rmap3_rows (BHD, f, v);
 }
 
 
-/* Differential of solute field with respect to solute coordinates. */
+/*
+  Returns the distance beyond which  |f(r)| <= eps.  The magnitude of
+  f(r) is  assumed to decay monotonically  for r >= r0,  as does the
+  LJ potential beyond its minimum at 2^(1/6) σ and the short range
+  Coulomb everywhere.  Bracket by doubling, then bisect:
+*/
+static real
+cutoff (real (*f)(real r), real r0, real eps)
+{
+  real lo = r0, hi = r0;
+  while (fabs (f (hi)) > eps)
+    {
+      lo = hi;
+      hi = 2 * hi;
+    }
+
+  if (hi == r0)
+    return r0;
+
+  for (int iter = 0; iter < 50 && hi - lo > 1.0e-6 * hi; iter++)
+    {
+      const real r = (lo + hi) / 2;
+      if (fabs (f (r)) > eps)
+        lo = r;
+      else
+        hi = r;
+    }
+  return hi;
+}
+
+
+/*
+  Cutoff radius of  the LJ force c (e/s) lj1(r/s)  for the error tol.
+  Note that  lj1() vanishes at the  LJ minimum 2^(1/6) s  and peaks at
+  (26/7)^(1/6) s ~ 1.24 s,  only beyond the latter |lj1| decays
+  monotonically:
+*/
+static real
+lj1_cutoff (real c, real e, real s, real tol)
+{
+  real pure f (real r)
+  {
+    return c * (e / s) * ljcap1 (r / s);
+  }
+
+  return cutoff (f, pow (26.0 / 7.0, 1.0 / 6.0) * s, tol);
+}
+
+
+/*
+  Same as  field0() up to an error  of at most tol  at every grid
+  point.  Each solute site contributes only  within its cutoff radius
+  where the  pair interaction drops below  tol / n,  the tail beyond
+  is neglected.   The local grid is  processed in blocks.  The solute
+  sites are binned into  a cell list so  that for each block only the
+  sites  in  the  neighbouring   cells  are  checked  against  their
+  cutoff.  For large solutes the cost is then proportional to the
+  number of sites per cutoff volume instead of n.
+*/
+static void
+field0_cutoff (const State *BHD, const Site *a,
+               int n, const Site solute[n], /* in */
+               real tol,                    /* in */
+               Vec v)                       /* out */
+{
+  const real G = G_COULOMB_INVERSE_RANGE;
+  const real *L = BHD->PD->L;   /* [3] */
+  const real *h = BHD->PD->h;   /* [3] */
+
+  /* Pair parameters and cutoff radii, as in field0(): */
+  real eab[n], sab[n], qab[n], rc[n];
+  real rcmax = 0.0;
+  for (int i = 0; i < n; i++)
+    {
+      const Site *b = &solute[i]; /* shorter alias */
+
+      eab[i] = sqrt (a->epsilon * b->epsilon);
+      sab[i] = 0.5 * (a->sigma + b->sigma);
+      qab[i] = a->charge * b->charge * EPSILON0INV;
+
+      real pure f (real r)
+      {
+        real e = qab[i] * G * cs0 (G * r);
+        if (eab[i] != 0.0)
+          e = fabs (e) + fabs (eab[i] * lj0 (r / sab[i]));
+        return e;
+      }
+
+      if (eab[i] == 0.0 && qab[i] == 0.0)
+        rc[i] = 0.0;            /* no interaction at all */
+      else
+        rc[i] = cutoff (f, MAX (pow (2.0, 1.0 / 6.0) * sab[i], 0.1 / G), tol / n);
+
+      rcmax = MAX (rcmax, rc[i]);
+    }
+
+  if (rcmax == 0.0)
+    {
+      VecSet (v, 0.0);
+      return;
+    }
+
+  /*
+    Cell list.   Cells are at least  rcmax wide, so that  for a given
+    block only the  cells overlapping the block inflated  by rcmax need
+    to be visited. Limit the number of cells for sparse solutes:
+  */
+  real lo[3], hi[3];
+  FOR_DIM
+    {
+      lo[dim] = hi[dim] = solute[0].x[dim];
+      for (int i = 1; i < n; i++)
+        {
+          lo[dim] = MIN (lo[dim], solute[i].x[dim]);
+          hi[dim] = MAX (hi[dim], solute[i].x[dim]);
+        }
+    }
+
+  real cell[3];
+  int nc[3];
+  FOR_DIM
+    {
+      cell[dim] = MAX (rcmax, (hi[dim] - lo[dim]) / 16);
+      nc[dim] = (int) ((hi[dim] - lo[dim]) / cell[dim]) + 1;
+    }
+
+  int cell_index (int dim, real x)
+  {
+    const int c = floor ((x - lo[dim]) / cell[dim]);
+    return MAX (0, MIN (nc[dim] - 1, c));
+  }
+
+  int head[nc[2]][nc[1]][nc[0]], next[n];
+  for (int c2 = 0; c2 < nc[2]; c2++)
+    for (int c1 = 0; c1 < nc[1]; c1++)
+      for (int c0 = 0; c0 < nc[0]; c0++)
+        head[c2][c1][c0] = -1;
+
+  for (int i = 0; i < n; i++)
+    {
+      int c[3];
+      FOR_DIM
+        c[dim] = cell_index (dim, solute[i].x[dim]);
+
+      next[i] = head[c[2]][c[1]][c[0]];
+      head[c[2]][c[1]][c[0]] = i;
+    }
+
+  real ***v_;
+  DMDAVecGetArray (BHD->da, v, &v_);
+
+  int ng[3], ag[3];
+  DMDAGetCorners (BHD->da, &ag[0], &ag[1], &ag[2], &ng[0], &ng[1], &ng[2]);
+
+  /* Blocks of B³ grid points: */
+  const int B = 8;
+  int nb[3];
+  FOR_DIM
+    nb[dim] = (ng[dim] + B - 1) / B;
+
+#pragma omp parallel for schedule(dynamic)
+  for (int ib = 0; ib < nb[0] * nb[1] * nb[2]; ib++)
+    {
+      const int b3[3] = {ib % nb[0], (ib / nb[0]) % nb[1], ib / (nb[0] * nb[1])};
+
+      /* Index range and bounding box of this block: */
+      int i0[3], i1[3];
+      real x0[3], x1[3];
+      FOR_DIM
+        {
+          i0[dim] = ag[dim] + b3[dim] * B;
+          i1[dim] = MIN (i0[dim] + B, ag[dim] + ng[dim]);
+          x0[dim] = i0[dim] * h[dim] - L[dim] / 2;
+          x1[dim] = (i1[dim] - 1) * h[dim] - L[dim] / 2;
+        }
+
+      /* Sites within their cutoff of the block: */
+      int cand[n];
+      int nn = 0;
+      int c0[3], c1[3];
+      FOR_DIM
+        {
+          c0[dim] = cell_index (dim, x0[dim] - rcmax);
+          c1[dim] = cell_index (dim, x1[dim] + rcmax);
+        }
+
+      for (int c2 = c0[2]; c2 <= c1[2]; c2++)
+        for (int cy = c0[1]; cy <= c1[1]; cy++)
+          for (int cx = c0[0]; cx <= c1[0]; cx++)
+            for (int i = head[c2][cy][cx]; i >= 0; i = next[i])
+              {
+                real d2 = 0.0;
+                FOR_DIM
+                  {
+                    const real x = solute[i].x[dim];
+                    const real d = MAX (0.0, MAX (x0[dim] - x, x - x1[dim]));
+                    d2 += d * d;
+                  }
+                if (d2 < SQR (rc[i]))
+                  cand[nn++] = i;
+              }
+
+      for (int k = i0[2]; k < i1[2]; k++)
+        for (int j = i0[1]; j < i1[1]; j++)
+          for (int i = i0[0]; i < i1[0]; i++)
+            {
+              const int ijk[3] = {i, j, k};
+
+              real x[3];
+              FOR_DIM
+                x[dim] = ijk[dim] * h[dim] - L[dim] / 2;
+
+              real e = 0.0;
+              for (int p = 0; p < nn; p++)
+                {
+                  const int ip = cand[p];
+
+                  /* Distance from a grid point to this site: */
+                  const real rab = distance (x, solute[ip].x);
+                  if (rab >= rc[ip])
+                    continue;
+
+                  /* Lennard-Jones + Coulomb, short range part: */
+                  e += eab[ip] * ljcap0 (rab / sab[ip]) +
+                    qab[ip] * G * cscap0 (G * rab);
+                }
+              v_[k][j][i] = e;
+            }
+    }
+  DMDAVecRestoreArray (BHD->da, v, &v_);
+}
+
+
+/*
+  Differential of solute field with respect to solute coordinates.
+  With tol > 0  the LJ term is only evaluated within the distance of
+  the moving site where it  contributes more than tol.  The Coulomb
+  term is  not truncated, beyond the  capping radius it  is the cheap
+  analytic -1/r².
+*/
 static void
 field1 (const State *BHD, const Site *a,
         int n, const Site solute[n],  /* in */
         real dx[n][3],                /* in */
+        real tol,                     /* in, or 0 */
         Vec dv)                       /* out */
 {
   const real G = G_COULOMB_INVERSE_RANGE;
@@ -408,6 +652,21 @@ field1 (const State *BHD, const Site *a,
   assert (lo == hi);
   assert (moving[lo]);
 
+  /* LJ cutoff radius of the moving site, infinite for tol = 0: */
+  real rc = INFINITY;
+  if (tol > 0.0)
+    {
+      const Site *b = &solute[lo];
+      const real eab = sqrt (a->epsilon * b->epsilon);
+      const real sab = 0.5 * (a->sigma + b->sigma);
+      const real dx1 = len3 (dx[lo]);
+
+      if (eab == 0.0 || dx1 == 0.0)
+        rc = 0.0;
+      else
+        rc = lj1_cutoff (dx1, eab, sab, tol);
+    }
+
   /* Differential  of  potential energy  of  Site  a  at x[3]  in  the
      presense of n-site solute: */
   real f3 (const real x[3])
@@ -459,12 +718,22 @@ field1 (const State *BHD, const Site *a,
             this further.
           */
           assert (likely (sab != 0.0));
-          de += drab *
-            ((eab / sab) * ljcap1 (rab / sab) + qab * G * G * ccap1 (G * rab));
+          if (rab < rc)
+            de += drab *
+              ((eab / sab) * ljcap1 (rab / sab) + qab * G * G * ccap1 (G * rab));
+          else
+            de += drab * qab * G * G * ccap1 (G * rab);
         }
       return de;
     }
-  vec_rmap3 (BHD, f3, dv);
+
+  /* Direct calls of f3(), can be inlined: */
+  void f (int np, const real x[np][3], real de[np])
+  {
+    for (int p = 0; p < np; p++)
+      de[p] = f3 (x[p]);
+  }
+  vec_rmap3_rows (BHD, f, dv);
 }
 
 
@@ -556,24 +825,31 @@ cores (const State *BHD,
        int n, const real q[n], real r[n][3], real G, /* in */
        Vec rho)                 /* out, real, center */
 {
-  real f3 (const real x[3])
+  const real norm = pow (G / sqrt (M_PI), 3);
+
+  void f (int np, const real x[np][3], real sum[np])
   {
+    for (int p = 0; p < np; p++)
+      sum[p] = 0.0;
+
     /* Sum Gaussian contributions from all (solute) sites: */
-    real sum = 0.0;
     for (int i = 0; i < n; i++)
-      {
-        /* Square of the distance from a grid point to this site: */
-        real r2 = SQR (x[0] - r[i][0]) +
-                  SQR (x[1] - r[i][1]) +
-                  SQR (x[2] - r[i][2]);
-
-        /* Gaussian  distribution, note  that G  is not  a  width, but
-           rather an inverse of it: */
-        sum += q[i] * exp(- SQR (G) * r2);
-      }
-    return pow (G / sqrt (M_PI), 3) * sum;
+      for (int p = 0; p < np; p++)
+        {
+          /* Square of the distance from a grid point to this site: */
+          const real r2 = SQR (x[p][0] - r[i][0]) +
+                          SQR (x[p][1] - r[i][1]) +
+                          SQR (x[p][2] - r[i][2]);
+
+          /* Gaussian distribution, note that G is not a width, but
+             rather an inverse of it: */
+          sum[p] += q[i] * exp (- SQR (G) * r2);
+        }
+
+    for (int p = 0; p < np; p++)
+      sum[p] *= norm;
   }
-  vec_rmap3 (BHD, f3, rho);
+  vec_rmap3_rows (BHD, f, rho);
 }
 
 
@@ -623,6 +899,228 @@ konv (Vec a_fft, Vec b_fft)
 }
 
 
+/*
+  PARTICLE-MESH FORM FACTOR
+  =========================
+
+  Tabulating  form_factor() costs  a complex  exponential  per site  and
+  k-point.   The alternative is  to spread  the point  charges onto the
+  real-space grid with cardinal B-splines M  of order p, do one FFT and
+  divide  by  the  Fourier  transform  of the  spline  sampled  at the
+  integers (smooth PME).  In grid units u = (x + L/2) / h
+
+    exp (-2πi mu/N) ≈ Σ  M (u - j) exp (-2πi mj/N) / D(m)
+                       j  p
+
+    D(m) = Σ  M (l) exp (2πi ml/N)
+            l  p
+
+  The  result  approximates the  centered  form  factor, the  relative
+  error  grows as  (m/N)^p.   Here  M[l] =  M  (w +  l) for  0 <= w  <
+  1 and l = 0, ..., p - 1 as by recursion from M₂:      p
+*/
+static void
+bspline (int p, real w, real M[p])
+{
+  assert (p >= 2);
+
+  M[0] = w;
+  M[1] = 1 - w;
+  for (int l = 2; l < p; l++)
+    M[l] = 0.0;
+
+  /* M    (t) = [t M (t) + (k + 1 - t) M (t - 1)] / k */
+  /*  k+1          k                   k          */
+  for (int k = 2; k < p; k++)
+    for (int l = k; l >= 0; l--)
+      M[l] = ((w + l) * M[l] + (l > 0 ? (k + 1 - w - l) * M[l - 1] : 0.0)) / k;
+}
+
+
+/*
+  Lowest even spline order for  which the interpolation error at the
+  k  where  the  Gaussian envelope  exp(-k²/4G²)  drops below  tol is
+  also below tol.  All users of  the form factor in this file multiply
+  it by such an envelope.  Returns zero if no order up to 16 will do,
+  e.g. for a grid too coarse for the Gaussian:
+*/
+static int
+pm_order (const ProblemData *PD, real G, real tol)
+{
+  const real k = 2 * G * sqrt (-log (tol));
+
+  real theta = 0.0;
+  FOR_DIM
+    theta = MAX (theta, k * PD->h[dim] / (2 * M_PI));
+
+  /* Beyond the Nyquist frequency no order will do: */
+  if (theta >= 0.5)
+    return 0;
+
+  int p = 4;
+  while (p < 16 && 2 * pow (theta / (1 - theta), p) > tol)
+    p += 2;
+
+  if (2 * pow (theta / (1 - theta), p) > tol)
+    return 0;
+
+  return p;
+}
+
+
+/*
+  Tabulates the  centered form factor  approximated by spline order p
+  into f_fft, times exp(-k²/4G²)  if G > 0. Each  worker spreads all
+  charges, but only onto its own part of the grid. Then one FFT:
+*/
+static void
+pm_form (const State *BHD, int p,
+         int n, const real q[n], real x[n][3], real G, /* in */
+         Vec f_fft)                                    /* out, center */
+{
+  const ProblemData *PD = BHD->PD;
+  const int *N = PD->N;         /* [3] */
+
+  local Vec rho = vec_create (BHD->da);
+  VecSet (rho, 0.0);
+
+  int a[3], ng[3];
+  DMDAGetCorners (BHD->da, &a[0], &a[1], &a[2], &ng[0], &ng[1], &ng[2]);
+
+  {
+    real ***rho_;
+    DMDAVecGetArray (BHD->da, rho, &rho_);
+
+    for (int i = 0; i < n; i++)
+      {
+        int j0[3];
+        real M[3][p];
+        FOR_DIM
+          {
+            const real u = (x[i][dim] + PD->L[dim] / 2) / PD->h[dim];
+            j0[dim] = floor (u);
+            bspline (p, u - j0[dim], M[dim]);
+          }
+
+        /* Index  j = j0 -  l with weight  M[l], periodic, if in the
+           local portion of the grid: */
+        int j[3][p];
+        FOR_DIM
+          for (int l = 0; l < p; l++)
+            {
+              const int jl = ((j0[dim] - l) % N[dim] + N[dim]) % N[dim];
+              j[dim][l] = (jl >= a[dim] && jl < a[dim] + ng[dim]) ? jl : -1;
+            }
+
+        for (int l2 = 0; l2 < p; l2++)
+          for (int l1 = 0; l1 < p; l1++)
+            for (int l0 = 0; l0 < p; l0++)
+              if (j[0][l0] >= 0 && j[1][l1] >= 0 && j[2][l2] >= 0)
+                rho_[j[2][l2]][j[1][l1]][j[0][l0]] +=
+                  q[i] * M[0][l0] * M[1][l1] * M[2][l2];
+      }
+    DMDAVecRestoreArray (BHD->da, rho, &rho_);
+  }
+
+  MatMult (BHD->fft_mat, rho, f_fft);
+  vec_destroy (&rho);
+
+  /* Deconvolution tables D(m) for each direction: */
+  real Mp[p];
+  bspline (p, 0.0, Mp);         /* M[l] = M (l) */
+                                /*         p    */
+  const int nmax = MAX (N[0], MAX (N[1], N[2]));
+  complex D[3][nmax];
+  FOR_DIM
+    for (int m = 0; m < N[dim]; m++)
+      {
+        D[dim][m] = 0.0;
+        for (int l = 1; l < p; l++)
+          D[dim][m] += Mp[l] * cexp (2 * M_PI * I * m * l / N[dim]);
+      }
+
+  real dk[3];
+  FOR_DIM
+    dk[dim] = 2 * M_PI / PD->L[dim];
+
+  local Vec d_fft = vec_create (BHD->dc);
+
+  complex pure f3 (const real k[3])
+  {
+    complex d = 1.0;
+    FOR_DIM
+      {
+        const int m = lround (k[dim] / dk[dim]);
+        d *= D[dim][(m + N[dim]) % N[dim]];
+      }
+
+    const real envelope = (G > 0.0 ? exp (-dot3 (k, k) / (4 * SQR (G))) : 1.0);
+    return envelope / d;
+  }
+
+  void f (int np, const real k[np][3], complex fk[np])
+  {
+    for (int p = 0; p < np; p++)
+      fk[p] = f3 (k[p]);
+  }
+  vec_kmap3_rows (BHD, f, d_fft);
+
+  konv (d_fft, f_fft);
+  vec_destroy (&d_fft);
+}
+
+
+/*
+  With --pm-tol  return the spline  order for  pm_form(), otherwise
+  zero for the exact path.  Also zero if  the tolerance cannot be met
+  by particle-mesh:
+*/
+static int
+pm_option (const State *BHD)
+{
+  real tol = 0.0;
+  bgy3d_getopt_real ("pm-tol", &tol);
+
+  if (tol <= 0.0)
+    return 0;
+
+  const int p = pm_order (BHD->PD, G_COULOMB_INVERSE_RANGE, tol);
+
+  /* Say it once, this is called for every solute field: */
+  static bool warned = false;
+  if (p == 0 && !warned)
+    {
+      FPRINTF (stderr, "Warning: --pm-tol %g not reachable on this grid,"
+               " using exact form factors\n", tol);
+      warned = true;
+    }
+
+  return p;
+}
+
+
+/*
+  Same as cores(), by particle-mesh.   Differs in that images of the
+  periodic box overlap, negligible for narrow Gaussians away from the
+  border:
+*/
+static void
+cores_pm (const State *BHD, int p,
+          int n, const real q[n], real r[n][3], real G, /* in */
+          Vec rho)                                      /* out, real, center */
+{
+  local Vec rho_fft = vec_create (BHD->dc);
+
+  pm_form (BHD, p, n, q, r, G, rho_fft);
+
+  /* Unnormalized backward FFT, divide by volume: */
+  MatMultTranspose (BHD->fft_mat, rho_fft, rho);
+  VecScale (rho, 1.0 / (BHD->PD->L[0] * BHD->PD->L[1] * BHD->PD->L[2]));
+
+  vec_destroy (&rho_fft);
+}
+
+
 /*
   Updates  v_fft with  its  convolution with  the "instantaneous  core
   density" of solutes. Technically, scales the k-component v(k) by the
@@ -636,16 +1134,24 @@ solute_form (const State *BHD, int n, const real q[n], real x[n][3],
 {
   local Vec f_fft = vec_create (BHD->dc);
 
-  /* FIXME: recomputing this every call? Tabulate form factor: */
-  complex pure f3 (const real k[3])
-  {
-    return form_factor (k, n, q, x);
-  }
-  vec_kmap3 (BHD, f3, f_fft);
+  /* With --pm-tol by particle-mesh, centered already: */
+  const int p = pm_option (BHD);
+  if (p > 0)
+    pm_form (BHD, p, n, q, x, 0.0, f_fft);
+  else
+    {
+      /* FIXME: recomputing this every call? Tabulate form factor: */
+      void f (int np, const real k[np][3], complex fk[np])
+      {
+        for (int p = 0; p < np; p++)
+          fk[p] = form_factor (k[p], n, q, x);
+      }
+      vec_kmap3_rows (BHD, f, f_fft);
 
-  /* We choose to center the form  factor, so that it becomes the true
-     fourier representation of the point charge density: */
-  bgy3d_vec_fft_trans (BHD->dc, BHD->PD->N, f_fft);
+      /* We choose to center the form factor, so that it becomes the
+         true fourier representation of the point charge density: */
+      bgy3d_vec_fft_trans (BHD->dc, BHD->PD->N, f_fft);
+    }
 
   /* Pointwise-product in k-space, v(k) *= f(k): */
   for (int i = 0; i < m; i++)
@@ -664,11 +1170,12 @@ solute_form1 (const State *BHD, int n, const real q[n], real x[n][3],
   local Vec f_fft = vec_create (BHD->dc);
 
   /* Tabulate form factor: */
-  complex pure f3 (const real k[3])
+  void f (int np, const real k[np][3], complex fk[np])
   {
-    return form_factor1 (k, n, q, x, dx);
+    for (int p = 0; p < np; p++)
+      fk[p] = form_factor1 (k[p], n, q, x, dx);
   }
-  vec_kmap3 (BHD, f3, f_fft);
+  vec_kmap3_rows (BHD, f, f_fft);
 
   /* See solute_form() for explanation: */
   bgy3d_vec_fft_trans (BHD->dc, BHD->PD->N, f_fft);
@@ -797,21 +1304,26 @@ coulomb_long (const State *BHD,
               int n, const real q[n], real x[n][3], real G, /* in */
               Vec uc)           /* out, real, center */
 {
-  real f3 (const real y[3])
+  void f (int np, const real y[np][3], real sum[np])
   {
+    for (int p = 0; p < np; p++)
+      sum[p] = 0.0;
+
     /* Sum contributions from all (solute) sites: */
-    real sum = 0.0;
     for (int i = 0; i < n; i++)
-      {
-        /* Distance from a grid point to this site: */
-        real r = distance (y, x[i]);
+      for (int p = 0; p < np; p++)
+        {
+          /* Distance from a grid point to this site: */
+          const real r = distance (y[p], x[i]);
 
-        /* cl0(r) == erf(r)/r */
-        sum += q[i] * G * cl0 (G * r);
-      }
-    return EPSILON0INV * sum;
+          /* cl0(r) == erf(r)/r */
+          sum[p] += q[i] * G * cl0 (G * r);
+        }
+
+    for (int p = 0; p < np; p++)
+      sum[p] *= EPSILON0INV;
   }
-  vec_rmap3 (BHD, f3, uc);
+  vec_rmap3_rows (BHD, f, uc);
 }
 
 
@@ -891,13 +1403,24 @@ bgy3d_solute_field (const State *BHD,
     makes  a  point  charge  (Coulomb  short  +  Coulomb  long)  to  a
     distributed Gaussian (Coulomb long only).
   */
+  /*
+    With --field-tol the  pairs are  truncated where they contribute
+    less than that, see field0_cutoff().  Otherwise all pairs are summed
+    at every grid point:
+  */
+  real tol = 0.0;
+  bgy3d_getopt_real ("field-tol", &tol);
+
   if (us)    /* Not quite sure if passing us = NULL is legal though */
     for (int i = 0; i < m; i++)
       {
         Site a = solvent[i];          /* dont modify the input */
         a.charge *= scale_coul_short; /* modify a copy */
 
-        field0 (BHD, &a, n, solute, us[i]);
+        if (tol > 0.0)
+          field0_cutoff (BHD, &a, n, solute, tol, us[i]);
+        else
+          field0 (BHD, &a, n, solute, us[i]);
       }
 
   /*
@@ -943,7 +1466,14 @@ bgy3d_solute_field (const State *BHD,
       compute some observables:
     */
     if (uc_rho)
-      cores (BHD, n, q, x, G, uc_rho);
+      {
+        /* With --pm-tol by particle-mesh: */
+        const int p = pm_option (BHD);
+        if (p > 0)
+          cores_pm (BHD, p, n, q, x, G, uc_rho);
+        else
+          cores (BHD, n, q, x, G, uc_rho);
+      }
 
     /*
       Real-space representation of  the long-range potential is needed
@@ -1040,6 +1570,132 @@ bgy3d_solute_field1 (const State *BHD,
                      real dx[n][3],                /* in */
                      Vec dv[m])                    /* out */
 {
+  /* See bgy3d_solute_field(): */
+  real tol = 0.0;
+  bgy3d_getopt_real ("field-tol", &tol);
+
   for (int i = 0; i < m; i++)
-    field1 (BHD, &solvent[i], n, solute, dx, dv[i]);
+    field1 (BHD, &solvent[i], n, solute, dx, tol, dv[i]);
+}
+
+
+/*
+  Gradients of
+
+    E = Σ  ∫ w (x) v (x) d³x
+         a    a     a
+
+  with respect to  all solute coordinates in one sweep  over the grid.
+  The same as  3n calls to bgy3d_solute_field1() with  unit modes, one
+  solute site and  direction at a time, each followed  by m integrals.
+  Here each pair distance is  computed once and contributes to all
+  three components.  The weights w[] include the volume element:
+*/
+void
+bgy3d_solute_field_grad (const State *BHD,
+                         int m, const Site solvent[m], /* in */
+                         int n, const Site solute[n],  /* in */
+                         Vec w[m],                     /* in */
+                         real dE[n][3])                /* out */
+{
+  const real G = G_COULOMB_INVERSE_RANGE;
+  const real *L = BHD->PD->L;   /* [3] */
+  const real *h = BHD->PD->h;   /* [3] */
+
+  /* See bgy3d_solute_field(): */
+  real tol = 0.0;
+  bgy3d_getopt_real ("field-tol", &tol);
+
+  /* Pair parameters as in field1(), and LJ cutoffs for tol > 0: */
+  real eab[m][n], sab[m][n], qab[m][n], rc[m][n];
+  for (int a = 0; a < m; a++)
+    for (int b = 0; b < n; b++)
+      {
+        eab[a][b] = sqrt (solvent[a].epsilon * solute[b].epsilon);
+        sab[a][b] = 0.5 * (solvent[a].sigma + solute[b].sigma);
+        qab[a][b] = solvent[a].charge * solute[b].charge * EPSILON0INV;
+
+        if (tol <= 0.0)
+          rc[a][b] = INFINITY;
+        else if (eab[a][b] == 0.0)
+          rc[a][b] = 0.0;
+        else
+          rc[a][b] = lj1_cutoff (1.0, eab[a][b], sab[a][b], tol);
+      }
+
+  real ***w_[m];
+  for (int a = 0; a < m; a++)
+    DMDAVecGetArray (BHD->da, w[a], &w_[a]);
+
+  int ng[3], ag[3];
+  DMDAGetCorners (BHD->da, &ag[0], &ag[1], &ag[2], &ng[0], &ng[1], &ng[2]);
+
+  for (int b = 0; b < n; b++)
+    FOR_DIM
+      dE[b][dim] = 0.0;
+
+#pragma omp parallel
+  {
+    /* Private accumulator, summed up at the end: */
+    real de[n][3];
+    for (int b = 0; b < n; b++)
+      FOR_DIM
+        de[b][dim] = 0.0;
+
+#pragma omp for collapse(2)
+    for (int k = ag[2]; k < ag[2] + ng[2]; k++)
+      for (int j = ag[1]; j < ag[1] + ng[1]; j++)
+        for (int i = ag[0]; i < ag[0] + ng[0]; i++)
+          {
+            const int ijk[3] = {i, j, k};
+
+            real x[3];
+            FOR_DIM
+              x[dim] = ijk[dim] * h[dim] - L[dim] / 2;
+
+            for (int b = 0; b < n; b++)
+              {
+                /* Distance vector from site b to the grid point: */
+                real ab[3];
+                FOR_DIM
+                  ab[dim] = x[dim] - solute[b].x[dim];
+
+                const real rab = len3 (ab);
+
+                /* No sensible limit for rab -> 0, see field1(): */
+                if (unlikely (rab == 0.0))
+                  continue;
+
+                /* Σ  w  dv/dr, see field1() for the terms: */
+                /*  a  a                                     */
+                real s = 0.0;
+                for (int a = 0; a < m; a++)
+                  {
+                    const real wa = w_[a][k][j][i];
+
+                    real d = qab[a][b] * G * G * ccap1 (G * rab);
+                    if (rab < rc[a][b])
+                      d += (eab[a][b] / sab[a][b]) * ljcap1 (rab / sab[a][b]);
+
+                    s += wa * d;
+                  }
+
+                /* dr/dx  = -(x - x ) / r */
+                /*     b           b      */
+                FOR_DIM
+                  de[b][dim] -= s * ab[dim] / rab;
+              }
+          }
+
+#pragma omp critical
+    for (int b = 0; b < n; b++)
+      FOR_DIM
+        dE[b][dim] += de[b][dim];
+  }
+
+  for (int a = 0; a < m; a++)
+    DMDAVecRestoreArray (BHD->da, w[a], &w_[a]);
+
+  /* Sum over workers: */
+  comm_allreduce (n * 3, (real*) dE);
 }
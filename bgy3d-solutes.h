@@ -34,6 +34,13 @@ void bgy3d_solute_field1 (const State *BHD,
                           real dx[n][3],                /* in */
                           Vec dv[m]);                   /* out */
 
+/* Gradients of Σ ∫ w v  with respect to all solute coordinates: */
+void bgy3d_solute_field_grad (const State *BHD,
+                              int m, const Site solvent[m], /* in */
+                              int n, const Site solute[n],  /* in */
+                              Vec w[m],                     /* in */
+                              real dE[n][3]);               /* out */
+
 
 /* Replaces   v_fft[]  by  their   convolutions  with   electric  form
    factor: */
@@ -17,54 +17,106 @@
     xtab[i] = f(x ), for x = (i + 1/2) dx
                  i        i
 
-  FIXME: precompute derivatives once things start becoming costly.
+  This  is  split into locating the nearest table entry  i  with the
+  weight w  of the  central difference  and  the evaluation, see
+  vec_tab_value(). The latter is the only part that depends on  the
+  table.  FIXME: precompute derivatives once things start becoming
+  costly.
 */
-static
-real interp (real x, int n, const real xtab[n], real dx)
+static inline void
+interp_index (real x, int n, real dx, int *i, real *w)
 {
   const real ix = x / dx - 0.5; /* i(x), real! */
 
   /* Nearest table entry: */
-  const int i = ix + 0.5;           /* rounding! */
+  *i = ix + 0.5;                /* rounding! */
 
   /* FIXME: Table should be complete enough: */
-  assert_range (i, n);
+  assert_range (*i, n);
 
   /* Here [ip, im] = [i + 1, i - 1] in most cases: */
-  const int ip = (i < n - 2) ? i + 1 : i;
-  const int im = (i > 0 + 1) ? i - 1 : i;
+  const int ip = (*i < n - 2) ? *i + 1 : *i;
+  const int im = (*i > 0 + 1) ? *i - 1 : *i;
   assert_range (ip, n);         /* paranoya! */
   assert_range (im, n);         /* paranoya! */
   assert (ip - im > 0);         /* FIXME: fails for n < 2! */
 
-  /* Estimate for the derivative df/di: */
-  const real fi = (xtab[ip] - xtab[im]) / (ip - im);
-
   /* Note that  (ix - i) is  the *real* offset from  the nearest table
      entry: */
-  return xtab[i] + fi * (ix - i);
+  *w = (ix - *i) / (ip - im);
+}
+
+
+static inline
+real interp (real x, int n, const real xtab[n], real dx)
+{
+  int i;
+  real w;
+  interp_index (x, n, dx, &i, &w);
+
+  return vec_tab_value (n, xtab, i, w);
 }
 
 
 void vec_rtab (const State *HD, int n, const real rtab[n], real dr,
                       Vec v) /* out */
 {
-  pure real f (real r)
+  /* Row-wise, with interp() inlined into the loop: */
+  void f (int m, const real x[m][3], real fx[m])
   {
-    return interp (r, n, rtab, dr);
+    for (int i = 0; i < m; i++)
+      fx[i] = interp (sqrt (SQR (x[i][0]) + SQR (x[i][1]) + SQR (x[i][2])),
+                      n, rtab, dr);
   }
-  vec_rmap (HD, f, v);
+  vec_rmap3_rows (HD, f, v);
 }
 
 
 void vec_ktab (const State *HD, int n, const real ktab[n], real dk,
                       Vec v_fft) /* out */
 {
-  pure complex f (real k)
+  /* See vec_rtab(): */
+  void f (int m, const real k[m][3], complex fk[m])
   {
-    return interp (k, n, ktab, dk);
+    for (int i = 0; i < m; i++)
+      fk[i] = interp (sqrt (SQR (k[i][0]) + SQR (k[i][1]) + SQR (k[i][2])),
+                      n, ktab, dk);
   }
-  vec_kmap (HD, f, v_fft);
+  vec_kmap3_rows (HD, f, v_fft);
+}
+
+
+/*
+  Same as  vec_ktab() but  instead of  the  values store  the nearest
+  table  entry and the weight,  see vec_tab_value(), for each point of
+  the  local  section of  the k-grid  in the order  of the local array
+  of a complex Vec:
+*/
+void vec_ktab_index (const State *HD, int n, real dk,
+                     int idx[], real wgt[]) /* out */
+{
+  const ProblemData *PD = HD->PD;
+  const int *N = PD->N;         /* [3] */
+
+  real dq[3];                   /* k-mesh spacing */
+  FOR_DIM
+    dq[dim] = 2 * M_PI / PD->L[dim];
+
+  int a[3], s[3], kdim[3];
+  DMDAGetCorners (HD->dc, &a[0], &a[1], &a[2], &s[0], &s[1], &s[2]);
+  kspace_dims (HD->dc, kdim);
+
+  int ofs = 0, i[3];
+  for (i[2] = a[2]; i[2] < a[2] + s[2]; i[2]++)
+    for (i[1] = a[1]; i[1] < a[1] + s[1]; i[1]++)
+      for (i[0] = a[0]; i[0] < a[0] + s[0]; i[0]++, ofs++)
+        {
+          real k2 = 0.0;
+          FOR_DIM
+            k2 += SQR (KFREQ (i[kdim[dim]], N[dim]) * dq[dim]);
+
+          interp_index (sqrt (k2), n, dk, &idx[ofs], &wgt[ofs]);
+        }
 }
 
 
@@ -468,8 +520,8 @@ void bgy3d_vec_read_gpaw (DA da, const ProblemData *PD,
 
 
 /*
-  FIXME: vec_integrate() operates on  scalar functions only. Thus need
-  three   integrations   for  a   dipole   and   6  integrations   for
+  FIXME: vec_integrate_rows() operates on scalar functions only. Thus
+  need  three  integrations  for  a  dipole  and  6 integrations  for
   quadrupole:
 */
 static void
@@ -479,25 +531,34 @@ vec_moments1 (const DA da, Vec v, real d[3])
   int N[3];
   da_shape (da, N);
 
-  real mx (real v, int i, int j, int k)
+  real mx (int n, const real v[n], int i, int j, int k)
   {
     (void) j; (void) k;
-    return v * (i - 0.5 * N[0]);
+    real s = 0.0;
+    for (int p = 0; p < n; p++)
+      s += v[p] * (i + p - 0.5 * N[0]);
+    return s;
   }
-  real my (real v, int i, int j, int k)
+  real my (int n, const real v[n], int i, int j, int k)
   {
     (void) i; (void) k;
-    return v * (j - 0.5 * N[1]);
+    real s = 0.0;
+    for (int p = 0; p < n; p++)
+      s += v[p];
+    return s * (j - 0.5 * N[1]);
   }
-  real mz (real v, int i, int j, int k)
+  real mz (int n, const real v[n], int i, int j, int k)
   {
     (void) i; (void) j;
-    return v * (k - 0.5 * N[2]);
+    real s = 0.0;
+    for (int p = 0; p < n; p++)
+      s += v[p];
+    return s * (k - 0.5 * N[2]);
   }
 
-  d[0] = vec_integrate (da, mx, v);
-  d[1] = vec_integrate (da, my, v);
-  d[2] = vec_integrate (da, mz, v);
+  d[0] = vec_integrate_rows (da, mx, v);
+  d[1] = vec_integrate_rows (da, my, v);
+  d[2] = vec_integrate_rows (da, mz, v);
 }
 
 
@@ -514,58 +575,83 @@ vec_moments2 (const DA da, Vec v, real q[3][3])
   int N[3];
   da_shape (da, N);
 
+  /*
+    Row sums Σ v, Σ v x and Σ v x² along the fastest index, the other
+    two coordinates are constant in a row:
+  */
+  void sums (int n, const real v[n], int i, real s[3])
+  {
+    s[0] = s[1] = s[2] = 0.0;
+    for (int p = 0; p < n; p++)
+      {
+        const real x = i + p - 0.5 * N[0];
+        s[0] += v[p];
+        s[1] += v[p] * x;
+        s[2] += v[p] * x * x;
+      }
+  }
+
   /* <xy> */
-  real m01 (real v, int i, int j, int k)
+  real m01 (int n, const real v[n], int i, int j, int k)
   {
     (void) k;
-    return v * (i - 0.5 * N[0]) * (j - 0.5 * N[1]);
+    real s[3];
+    sums (n, v, i, s);
+    return s[1] * (j - 0.5 * N[1]);
   }
 
   /* <yz> */
-  real m12 (real v, int i, int j, int k)
+  real m12 (int n, const real v[n], int i, int j, int k)
   {
-    (void) i;
-    return v * (j - 0.5 * N[1]) * (k - 0.5 * N[2]);
+    real s[3];
+    sums (n, v, i, s);
+    return s[0] * (j - 0.5 * N[1]) * (k - 0.5 * N[2]);
   }
 
   /* <zx> */
-  real m20 (real v, int i, int j, int k)
+  real m20 (int n, const real v[n], int i, int j, int k)
   {
     (void) j;
-    return v * (k - 0.5 * N[2]) * (i - 0.5 * N[0]);
+    real s[3];
+    sums (n, v, i, s);
+    return s[1] * (k - 0.5 * N[2]);
   }
 
   /* <xx> */
-  real m00 (real v, int i, int j, int k)
+  real m00 (int n, const real v[n], int i, int j, int k)
   {
     (void) j;
     (void) k;
-    return v * SQR (i - 0.5 * N[0]);
+    real s[3];
+    sums (n, v, i, s);
+    return s[2];
   }
 
   /* <yy> */
-  real m11 (real v, int i, int j, int k)
+  real m11 (int n, const real v[n], int i, int j, int k)
   {
-    (void) i;
     (void) k;
-    return v * SQR (j - 0.5 * N[1]);
+    real s[3];
+    sums (n, v, i, s);
+    return s[0] * SQR (j - 0.5 * N[1]);
   }
 
   /* <zz> */
-  real m22 (real v, int i, int j, int k)
+  real m22 (int n, const real v[n], int i, int j, int k)
   {
-    (void) i;
     (void) j;
-    return v * SQR (k - 0.5 * N[2]);
+    real s[3];
+    sums (n, v, i, s);
+    return s[0] * SQR (k - 0.5 * N[2]);
   }
 
-  q[0][1] = q[1][0] = vec_integrate (da, m01, v);
-  q[1][2] = q[2][1] = vec_integrate (da, m12, v);
-  q[0][2] = q[2][0] = vec_integrate (da, m20, v);
+  q[0][1] = q[1][0] = vec_integrate_rows (da, m01, v);
+  q[1][2] = q[2][1] = vec_integrate_rows (da, m12, v);
+  q[0][2] = q[2][0] = vec_integrate_rows (da, m20, v);
 
-  q[0][0] = vec_integrate (da, m00, v);
-  q[1][1] = vec_integrate (da, m11, v);
-  q[2][2] = vec_integrate (da, m22, v);
+  q[0][0] = vec_integrate_rows (da, m00, v);
+  q[1][1] = vec_integrate_rows (da, m11, v);
+  q[2][2] = vec_integrate_rows (da, m22, v);
 }
 
 
@@ -618,10 +704,11 @@ bgy3d_moments (const State *BHD, Vec v, real q[1], real d[3], real Q[3][3])
 void
 bgy3d_vec_fft_trans (const DA dc, const int N[static 3], Vec v)
 {
-  int x[3], n[3], i[3];
+  int x[3], n[3], i[3], kdim[3];
 
   /* Get local portion of the grid */
   DMDAGetCorners (dc, &x[0], &x[1], &x[2], &n[0], &n[1], &n[2]);
+  kspace_dims (dc, kdim);
 
   /* Loop over local portion of grid: */
   complex ***v_;
@@ -635,7 +722,7 @@ bgy3d_vec_fft_trans (const DA dc, const int N[static 3], Vec v)
 
           /* Take negative frequencies for i > N/2: */
           FOR_DIM
-            ic[dim] = KFREQ (i[dim], N[dim]);
+            ic[dim] = KFREQ (i[kdim[dim]], N[dim]);
 
           /* phase shift factor for x=x+L/2 */
           const int sign = COSSIGN(ic[0]) * COSSIGN(ic[1]) * COSSIGN(ic[2]);
@@ -7,6 +7,10 @@
 
 /* FIXME: any better way? */
 #include <complex.h>
+#ifdef _OPENMP
+#include <omp.h>                /* omp_get_thread_num() */
+#endif
+#include "bgy3d-fftw.h"         /* bgy3d_fft_transposed() */
 
 void vec_rtab (const State *HD, int n, const real rtab[n], real dr,
                Vec v);          /* out */
@@ -14,6 +18,23 @@ void vec_rtab (const State *HD, int n, const real rtab[n], real dr,
 void vec_ktab (const State *HD, int n, const real ktab[n], real dk,
                Vec v_fft);      /* out */
 
+void vec_ktab_index (const State *HD, int n, real dk,
+                     int idx[], real wgt[]); /* out */
+
+/*
+  Linear interpolation in the table at the nearest entry i with the
+  weight  w of the central difference,  see vec_ktab_index() in
+  bgy3d-vec.c:
+*/
+static inline real
+vec_tab_value (int n, const real tab[n], int i, real w)
+{
+  const int ip = (i < n - 2) ? i + 1 : i;
+  const int im = (i > 0 + 1) ? i - 1 : i;
+
+  return tab[i] + w * (tab[ip] - tab[im]);
+}
+
 real bgy3d_vec_mix (Vec dg, Vec dg_new, real a, Vec work);
 
 void bgy3d_vec_save (const char file[], const Vec vec);
@@ -182,6 +203,25 @@ static inline int da_dof (const DA da)
 }
 
 
+/*
+  Map the dimensions of the real grid to those of the complex array
+  descriptor dc. This is  the identity unless the FFT produces the
+  transposed k-space layout, see --fft-transposed, in which case the
+  dimensions 1 and 2 are swapped.  Loop over the local section of dc
+  as usual, but take the frequencies in this way:
+
+    K[dim] = KFREQ (i[kdim[dim]], N[dim])
+*/
+static inline void kspace_dims (const DA dc, int kdim[static 3])
+{
+  const bool t = bgy3d_fft_transposed (dc);
+
+  kdim[0] = 0;
+  kdim[1] = t ? 2 : 1;
+  kdim[2] = t ? 1 : 2;
+}
+
+
 /*
   To create  a new  Vec one needs  the local  size. The total  size is
   computable.   This is  how  to get  the  local size  from the  array
@@ -305,6 +345,13 @@ static inline real vec_norm (Vec x)
   return norm;
 }
 
+static inline real vec_norm2 (Vec x)
+{
+  real norm;
+  VecNorm (x, NORM_2, &norm);
+  return norm;
+}
+
 static inline real vec_dot (Vec x, Vec y)
 {
   real dot;
@@ -327,6 +374,39 @@ static inline real vec_min (Vec x)
 }
 
 
+/*
+  Range [*a, *b) of  the  n  local  elements  for  the calling  OpenMP
+  thread. Chunks are contiguous and of about the same size. Without
+  OpenMP or outside of a parallel region this is all of [0, n).
+
+  Chunk  boundaries are  multiples  of VEC_CHUNK elements,  so that
+  (for aligned arrays) no two threads  write to the same cache line
+  and the inner loops of f() start  on a SIMD boundary. The last chunk
+  takes the remainder.  For complex arrays, counted in complex units,
+  that is 128 bytes:
+*/
+#define VEC_CHUNK 8
+
+static inline void thread_range (int n, int *a, int *b)
+{
+#ifdef _OPENMP
+  const long nt = omp_get_num_threads ();
+  const long t = omp_get_thread_num ();
+#else
+  const long nt = 1, t = 0;
+#endif
+  /* Number of whole and partial blocks: */
+  const long nb = (n + VEC_CHUNK - 1) / VEC_CHUNK;
+
+  /* Avoid overflow of nb * t for large grids: */
+  const long a_ = VEC_CHUNK * ((nb * t) / nt);
+  const long b_ = VEC_CHUNK * ((nb * (t + 1)) / nt);
+
+  *a = a_ < n ? a_ : n;
+  *b = b_ < n ? b_ : n;
+}
+
+
 /*
   The  following vec_map1(), vec_map2(),  vec_map3() should  be better
   inlined as they use a scalar function f().
@@ -334,6 +414,8 @@ static inline real vec_min (Vec x)
     ys = map (f, xs)
 
   Should also work with aliased arguments for in-place transform.
+  With OpenMP  f() is called by  several threads at once,  so it must
+  be pure. In particular it should not call Guile, see guile_vec_map1().
 */
 static inline void
 vec_map1 (Vec ys, real (*f)(real x), Vec xs)
@@ -344,8 +426,14 @@ vec_map1 (Vec ys, real (*f)(real x), Vec xs)
   local real *xs_ = vec_get_array (xs);
   local real *ys_ = vec_get_array (ys);
 
-  for (int i = 0; i < n; i++)
-    ys_[i] = f (xs_[i]);
+#pragma omp parallel
+  {
+    int a, b;
+    thread_range (n, &a, &b);
+
+    for (int i = a; i < b; i++)
+      ys_[i] = f (xs_[i]);
+  }
 
   vec_restore_array (xs, &xs_);
   vec_restore_array (ys, &ys_);
@@ -364,8 +452,14 @@ vec_map2 (Vec zs, real (*f)(real x, real y), Vec xs, Vec ys)
   local real *ys_ = vec_get_array (ys);
   local real *zs_ = vec_get_array (zs);
 
-  for (int i = 0; i < n; i++)
-    zs_[i] = f (xs_[i], ys_[i]);
+#pragma omp parallel
+  {
+    int a, b;
+    thread_range (n, &a, &b);
+
+    for (int i = a; i < b; i++)
+      zs_[i] = f (xs_[i], ys_[i]);
+  }
 
   vec_restore_array (xs, &xs_);
   vec_restore_array (ys, &ys_);
@@ -389,8 +483,14 @@ vec_map3 (Vec ws, real (*f)(real x, real y, real z),
   local real *zs_ = vec_get_array (zs);
   local real *ws_ = vec_get_array (ws);
 
-  for (int i = 0; i < n; i++)
-    ws_[i] = f (xs_[i], ys_[i], zs_[i]);
+#pragma omp parallel
+  {
+    int a, b;
+    thread_range (n, &a, &b);
+
+    for (int i = a; i < b; i++)
+      ws_[i] = f (xs_[i], ys_[i], zs_[i]);
+  }
 
   vec_restore_array (xs, &xs_);
   vec_restore_array (ys, &ys_);
@@ -404,6 +504,11 @@ vec_map3 (Vec ws, real (*f)(real x, real y, real z),
   solely  for performance reasons.   But I  hate prefixing  them. This
   code does not dictate what is in- and what is output. In fact all of
   them may be modified.  But should they?
+
+  With OpenMP  f() is called by several threads at once, each on its
+  own part of the arrays. It should not have side effects other than
+  the writes to  its array arguments. In particular it should not call
+  Guile.
 */
 static inline void
 vec_app2 (void (*f)(int n, real x0[n], real x1[n]),
@@ -415,7 +520,13 @@ vec_app2 (void (*f)(int n, real x0[n], real x1[n]),
   local real *x0_ = vec_get_array (x0);
   local real *x1_ = vec_get_array (x1);
 
-  f (n, x0_, x1_);
+  /* One contiguous chunk per thread, see thread_range(): */
+#pragma omp parallel
+  {
+    int a, b;
+    thread_range (n, &a, &b);
+    f (b - a, x0_ + a, x1_ + a);
+  }
 
   vec_restore_array (x0, &x0_);
   vec_restore_array (x1, &x1_);
@@ -434,7 +545,12 @@ vec_app3 (void (*f)(int n, real x0[n], real x1[n], real x2[n]),
   local real *x1_ = vec_get_array (x1);
   local real *x2_ = vec_get_array (x2);
 
-  f (n, x0_, x1_, x2_);
+#pragma omp parallel
+  {
+    int a, b;
+    thread_range (n, &a, &b);
+    f (b - a, x0_ + a, x1_ + a, x2_ + a);
+  }
 
   vec_restore_array (x0, &x0_);
   vec_restore_array (x1, &x1_);
@@ -456,7 +572,12 @@ vec_app4 (void (*f)(int n, real x0[n], real x1[n], real x2[n], real x3[n]),
   local real *x2_ = vec_get_array (x2);
   local real *x3_ = vec_get_array (x3);
 
-  f (n, x0_, x1_, x2_, x3_);
+#pragma omp parallel
+  {
+    int a, b;
+    thread_range (n, &a, &b);
+    f (b - a, x0_ + a, x1_ + a, x2_ + a, x3_ + a);
+  }
 
   vec_restore_array (x0, &x0_);
   vec_restore_array (x1, &x1_);
@@ -481,7 +602,12 @@ vec_app5 (void (*f)(int n, real x0[n], real x1[n], real x2[n], real x3[n], real
   local real *x3_ = vec_get_array (x3);
   local real *x4_ = vec_get_array (x4);
 
-  f (n, x0_, x1_, x2_, x3_, x4_);
+#pragma omp parallel
+  {
+    int a, b;
+    thread_range (n, &a, &b);
+    f (b - a, x0_ + a, x1_ + a, x2_ + a, x3_ + a, x4_ + a);
+  }
 
   vec_restore_array (x0, &x0_);
   vec_restore_array (x1, &x1_);
@@ -518,7 +644,13 @@ vec_app8 (void (*f)(int n,
   local real *x6_ = vec_get_array (x6);
   local real *x7_ = vec_get_array (x7);
 
-  f (n, x0_, x1_, x2_, x3_, x4_, x5_, x6_, x7_);
+#pragma omp parallel
+  {
+    int a, b;
+    thread_range (n, &a, &b);
+    f (b - a, x0_ + a, x1_ + a, x2_ + a, x3_ + a,
+       x4_ + a, x5_ + a, x6_ + a, x7_ + a);
+  }
 
   vec_restore_array (x0, &x0_);
   vec_restore_array (x1, &x1_);
@@ -543,7 +675,12 @@ vec_fft_app2 (void (*f)(int n, complex x0[n], complex x1[n]),
   local complex *x0_ = (complex*) vec_get_array (x0);
   local complex *x1_ = (complex*) vec_get_array (x1);
 
-  f (n, x0_, x1_);
+#pragma omp parallel
+  {
+    int a, b;
+    thread_range (n, &a, &b);
+    f (b - a, x0_ + a, x1_ + a);
+  }
 
   vec_restore_array (x0, (void*) &x0_);
   vec_restore_array (x1, (void*) &x1_);
@@ -563,7 +700,12 @@ vec_fft_app3 (void (*f)(int n, complex x0[n], complex x1[n], complex x2[n]),
   local complex *x1_ = (complex*) vec_get_array (x1);
   local complex *x2_ = (complex*) vec_get_array (x2);
 
-  f (n, x0_, x1_, x2_);
+#pragma omp parallel
+  {
+    int a, b;
+    thread_range (n, &a, &b);
+    f (b - a, x0_ + a, x1_ + a, x2_ + a);
+  }
 
   vec_restore_array (x0, (void*) &x0_);
   vec_restore_array (x1, (void*) &x1_);
@@ -584,19 +726,25 @@ void vec_rmap3 (const State *BHD, real (*f)(const real r[3]), Vec v)
   real ***v_;
   DMDAVecGetArray (BHD->da, v, &v_);
 
-  int n[3], a[3], i[3];
+  int n[3], a[3];
   DMDAGetCorners (BHD->da, &a[0], &a[1], &a[2], &n[0], &n[1], &n[2]);
 
-  /* loop over local portion of grid */
-  for (i[2] = a[2]; i[2] < a[2] + n[2]; i[2]++)
-    for (i[1] = a[1]; i[1] < a[1] + n[1]; i[1]++)
-      for (i[0] = a[0]; i[0] < a[0] + n[0]; i[0]++)
+  /*
+    Loop over  local portion of grid.   With OpenMP the  planes of the
+    section are shared among threads, so f() must be thread safe:
+  */
+#pragma omp parallel for collapse(2)
+  for (int k = a[2]; k < a[2] + n[2]; k++)
+    for (int j = a[1]; j < a[1] + n[1]; j++)
+      for (int i = a[0]; i < a[0] + n[0]; i++)
         {
+          const int ijk[3] = {i, j, k};
+
           real r[3];
           FOR_DIM
-            r[dim] = i[dim] * h[dim] - L[dim] / 2;
+            r[dim] = ijk[dim] * h[dim] - L[dim] / 2;
 
-          v_[i[2]][i[1]][i[0]] = f (r);
+          v_[k][j][i] = f (r);
         }
   DMDAVecRestoreArray (BHD->da, v, &v_);
 }
@@ -618,39 +766,120 @@ void vec_kmap3 (const State *BHD, complex (*f)(const real k[3]), Vec v_fft)
     dk[dim] = 2 * M_PI / PD->L[dim];
 
   /* Get local portion of the k-grid */
-  int a[3], n[3], i[3];
+  int a[3], n[3], kdim[3];
   DMDAGetCorners (BHD->dc, &a[0], &a[1], &a[2], &n[0], &n[1], &n[2]);
+  kspace_dims (BHD->dc, kdim);
 
   complex ***v_fft_;
   DMDAVecGetArray (BHD->dc, v_fft, &v_fft_);
 
-   /* loop over local portion of grid */
-  for (i[2] = a[2]; i[2] < a[2] + n[2]; i[2]++)
-    for (i[1] = a[1]; i[1] < a[1] + n[1]; i[1]++)
-      for (i[0] = a[0]; i[0] < a[0] + n[0]; i[0]++)
+  /* loop over local portion of grid, threaded as in vec_rmap3(): */
+#pragma omp parallel for collapse(2)
+  for (int i2 = a[2]; i2 < a[2] + n[2]; i2++)
+    for (int i1 = a[1]; i1 < a[1] + n[1]; i1++)
+      for (int i0 = a[0]; i0 < a[0] + n[0]; i0++)
         {
+          const int i[3] = {i0, i1, i2};
+
           real k[3];
 
           /* Take negative frequencies for i > N/2: */
           FOR_DIM
-            k[dim] = KFREQ (i[dim], N[dim]) * dk[dim];
+            k[dim] = KFREQ (i[kdim[dim]], N[dim]) * dk[dim];
 
-          v_fft_[i[2]][i[1]][i[0]] = f (k);
+          v_fft_[i2][i1][i0] = f (k);
         }
   DMDAVecRestoreArray (BHD->dc, v_fft, &v_fft_);
 }
 
 
+/*
+  Same as vec_rmap3() but the callback gets a whole row of n grid
+  points along the fastest  index at once.  One indirect call per row
+  leaves the inner loops of f() to the compiler:
+*/
+static inline
+void vec_rmap3_rows (const State *BHD,
+                     void (*f)(int n, const real r[n][3], real fr[n]),
+                     Vec v)
+{
+  const real *L = BHD->PD->L;   /* [3] */
+  const real *h = BHD->PD->h;   /* [3] */
+
+  real ***v_;
+  DMDAVecGetArray (BHD->da, v, &v_);
+
+  int n[3], a[3];
+  DMDAGetCorners (BHD->da, &a[0], &a[1], &a[2], &n[0], &n[1], &n[2]);
+
+#pragma omp parallel for collapse(2)
+  for (int k = a[2]; k < a[2] + n[2]; k++)
+    for (int j = a[1]; j < a[1] + n[1]; j++)
+      {
+        real r[n[0]][3];
+        for (int i = 0; i < n[0]; i++)
+          {
+            r[i][0] = (a[0] + i) * h[0] - L[0] / 2;
+            r[i][1] = j * h[1] - L[1] / 2;
+            r[i][2] = k * h[2] - L[2] / 2;
+          }
+
+        f (n[0], (const real (*)[3]) r, &v_[k][j][a[0]]);
+      }
+  DMDAVecRestoreArray (BHD->da, v, &v_);
+}
+
+
+/* Same as vec_kmap3(), a row of n k-points per call: */
+static inline
+void vec_kmap3_rows (const State *BHD,
+                     void (*f)(int n, const real k[n][3], complex fk[n]),
+                     Vec v_fft)
+{
+  const ProblemData *PD = BHD->PD;
+  const int *N = PD->N;         /* [3] */
+
+  real dk[3];                   /* k-mesh spacing */
+  FOR_DIM
+    dk[dim] = 2 * M_PI / PD->L[dim];
+
+  int a[3], n[3], kdim[3];
+  DMDAGetCorners (BHD->dc, &a[0], &a[1], &a[2], &n[0], &n[1], &n[2]);
+  kspace_dims (BHD->dc, kdim);
+
+  complex ***v_fft_;
+  DMDAVecGetArray (BHD->dc, v_fft, &v_fft_);
+
+#pragma omp parallel for collapse(2)
+  for (int i2 = a[2]; i2 < a[2] + n[2]; i2++)
+    for (int i1 = a[1]; i1 < a[1] + n[1]; i1++)
+      {
+        real k[n[0]][3];
+        for (int i0 = a[0]; i0 < a[0] + n[0]; i0++)
+          {
+            const int i[3] = {i0, i1, i2};
+
+            /* Take negative frequencies for i > N/2: */
+            FOR_DIM
+              k[i0 - a[0]][dim] = KFREQ (i[kdim[dim]], N[dim]) * dk[dim];
+          }
+
+        f (n[0], (const real (*)[3]) k, &v_fft_[i2][i1][a[0]]);
+      }
+  DMDAVecRestoreArray (BHD->dc, v_fft, &v_fft_);
+}
+
+
 /* Tabulate v = f(r) with origin at the grid center:  */
 static inline
 void vec_rmap (const State *BHD, real (*f)(real r), Vec v)
 {
-  real f3 (const real x[3])
+  void fr (int n, const real x[n][3], real fx[n])
   {
-    const real r2 = SQR (x[0]) + SQR (x[1]) + SQR (x[2]);
-    return f (sqrt (r2));
+    for (int i = 0; i < n; i++)
+      fx[i] = f (sqrt (SQR (x[i][0]) + SQR (x[i][1]) + SQR (x[i][2])));
   }
-  vec_rmap3 (BHD, f3, v);
+  vec_rmap3_rows (BHD, fr, v);
 }
 
 
@@ -664,12 +893,12 @@ void vec_rmap (const State *BHD, real (*f)(real r), Vec v)
 static inline
 void vec_kmap (const State *BHD, complex (*f)(real k), Vec v_fft)
 {
-  complex f3 (const real k[3])
+  void fr (int n, const real k[n][3], complex fk[n])
   {
-    const real k2 = SQR (k[0]) + SQR (k[1]) + SQR (k[2]);
-    return f (sqrt (k2));
+    for (int i = 0; i < n; i++)
+      fk[i] = f (sqrt (SQR (k[i][0]) + SQR (k[i][1]) + SQR (k[i][2])));
   }
-  vec_kmap3 (BHD, f3, v_fft);
+  vec_kmap3_rows (BHD, fr, v_fft);
 }
 
 
@@ -699,6 +928,35 @@ static inline real vec_integrate (DA da, real (*f)(real v, int i, int j, int k),
   return acc;
 }
 
+/*
+  Same  as vec_integrate(),  f(n, v,  i, j,  k) gets  a row of n values
+  v[] at grid indices (i, j, k), (i + 1, j, k), ...:
+*/
+static inline real vec_integrate_rows (DA da,
+                                       real (*f)(int n, const real v[n], int i, int j, int k),
+                                       Vec v)
+{
+  real acc = 0.0;
+
+  real ***v_;
+  DMDAVecGetArray (da, v, &v_);
+
+  int x[3], n[3];
+  DMDAGetCorners (da, &x[0], &x[1], &x[2], &n[0], &n[1], &n[2]);
+
+  for (int k = x[2]; k < x[2] + n[2]; k++)
+    for (int j = x[1]; j < x[1] + n[1]; j++)
+      acc += f (n[0], &v_[k][j][x[0]], x[0], j, k);
+
+  DMDAVecRestoreArray (da, v, &v_);
+
+  /* Sum accumulator over workers: */
+  comm_allreduce (1, &acc);
+
+  return acc;
+}
+
+
 /* Returns sum (1 - g): */
 static inline real vec_hole (Vec g)
 {
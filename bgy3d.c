@@ -24,57 +24,219 @@ int verbosity = 0;
 MPI_Comm comm_world_petsc = MPI_COMM_NULL;
 
 
-State* bgy3d_state_make (const ProblemData *PD)
+/*
+  Array descriptors, FFT plans and the Laplacian are pooled. Geometry
+  optimizations and the server loop solve on the same grid again and
+  again, and re-creating these for every evaluation is a significant
+  part of the setup.  Entries are keyed by the grid, the box, the
+  communicator and the FFT layout options.  A fresh State shell
+  pointing to the shared parts is handed out by bgy3d_state_make(),
+  so that each user may have its own PD.  Sharing an entry by nested
+  users is fine as the FFT buffers are only used within a call.  Idle
+  entries stay in the pool until evicted in FIFO order or until exit.
+  All of this is collective, every worker goes through the same
+  sequence of calls:
+*/
+typedef struct
 {
-  /*
-    FIXME: Memory limits? Accidentally  calling 3D code with a typical
-    dimension  of   1D?   Anyway,  N^3  should  not   overflow  in  3D
-    runs. Print a warning if N^3 is definitely over 2^31:
-  */
-  const int nmax = 1291;
-  if (PD->N[0] >= nmax && PD->N[1] >= nmax && PD->N[2] >= nmax)
-    FPRINTF (stderr, "Warning: grid %d x %d x %d too large for 3D!\n",
-             PD->N[0], PD->N[1], PD->N[2]);
-
-  /* Also initialize all pointers stored in State to NULL: */
-  State *BHD = calloc (1, sizeof *BHD);
-
-  BHD->PD = PD;
+  int N[3];                     /* key */
+  real L[3];                    /* key */
+  MPI_Comm comm;                /* key */
+  int pencil;                   /* key, --fft-pencil or 0 */
+  bool transposed;              /* key, --fft-transposed */
+  int refs;                     /* 0 = idle */
+  State core;                   /* with core.PD == NULL */
+} Entry;
+
+#define MAX_STATES 4
+static Entry pool[MAX_STATES];
+static int pool_size = 0, pool_next = 0;
+
+
+/* Create the parts of a State that depend on the grid only: */
+static void core_make (const ProblemData *PD, State *core)
+{
+  /* Also initialize all pointers to NULL: */
+  *core = (State) {0};
 
   /* Initialize  parallel  stuff,  fftw  +  petsc.  Data  distribution
      depends on the grid dimensions N[] and number of processors.  All
      other arguments are intent(out): */
-  bgy3d_fft_mat_create (PD->N, &BHD->fft_mat, &BHD->da, &BHD->dc);
+  bgy3d_fft_mat_create (PD->N, &core->fft_mat, &core->da, &core->dc);
 
 #ifdef L_BOUNDARY
-  /* Assemble Laplacian matrix and create KSP environment: */
-  BHD->dirichlet_mat = bgy3d_dirichlet_create (BHD->da, BHD->PD);
+  /* Assemble Laplacian matrix and create  KSP environment. Depends on
+     N[] and h[] only: */
+  core->dirichlet_mat = bgy3d_dirichlet_create (core->da, PD);
 #endif
 
 #ifdef L_BOUNDARY_MG
   /* multigrid, apparently needs two descriptors: */
 #error "Need BHD->da_dmmg"
 #endif
-
-  return BHD;
 }
 
-void bgy3d_state_destroy (State *BHD)
+
+static void core_destroy (MPI_Comm comm, State *core)
 {
-  MPI_Barrier (comm_world_petsc);
+  MPI_Barrier (comm);
 
 #ifdef L_BOUNDARY
-  assert (BHD->dirichlet_mat != NULL);
-  MatDestroy (&BHD->dirichlet_mat);
+  assert (core->dirichlet_mat != NULL);
+  MatDestroy (&core->dirichlet_mat);
 #endif
 
 #ifdef L_BOUNDARY_MG
-  DMMGDestroy (BHD->dmmg);
+  DMMGDestroy (core->dmmg);
 #endif
 
-  DMDestroy (&BHD->da);
-  DMDestroy (&BHD->dc);
-  MatDestroy (&BHD->fft_mat);
+  DMDestroy (&core->da);
+  DMDestroy (&core->dc);
+  MatDestroy (&core->fft_mat);
+}
+
+
+/*
+  Run by  exit() before finalize() in  bgy3d-guile.c which was
+  registered earlier. PETSc objects need to go before PetscFinalize():
+*/
+static void pool_clear (void)
+{
+  for (int i = 0; i < pool_size; i++)
+    core_destroy (pool[i].comm, &pool[i].core);
+
+  pool_size = 0;
+  pool_next = 0;
+}
+
+
+/*
+  FFT layout options, as read by bgy3d_fft_mat_create() from the
+  settings of this call:
+*/
+static void fft_layout (int *pencil, bool *transposed)
+{
+  int p1 = 0;
+  bgy3d_getopt_int ("fft-pencil", &p1);
+
+  *pencil = p1;
+  *transposed = (p1 == 0) && bgy3d_getopt_test ("fft-transposed");
+}
+
+
+static bool pool_match (const Entry *e, const ProblemData *PD)
+{
+  if (e->comm != comm_world_petsc)
+    return false;
+
+  int pencil;
+  bool transposed;
+  fft_layout (&pencil, &transposed);
+  if (e->pencil != pencil || e->transposed != transposed)
+    return false;
+
+  for (int i = 0; i < 3; i++)
+    if (e->N[i] != PD->N[i] || e->L[i] != PD->L[i])
+      return false;
+
+  return true;
+}
+
+
+/*
+  Returns an  entry with  the  parts for this  PD, or  NULL if the pool
+  is full of busy entries:
+*/
+static Entry* pool_get (const ProblemData *PD)
+{
+  for (int i = 0; i < pool_size; i++)
+    if (pool_match (&pool[i], PD))
+      return &pool[i];
+
+  /* Look for a free slot or an idle entry to evict, oldest first: */
+  Entry *e = NULL;
+  if (pool_size < MAX_STATES)
+    e = &pool[pool_size++];
+  else
+    for (int k = 0; k < MAX_STATES; k++)
+      {
+        Entry *f = &pool[(pool_next + k) % MAX_STATES];
+        if (f->refs == 0)
+          {
+            core_destroy (f->comm, &f->core);
+            e = f;
+            break;
+          }
+      }
+
+  if (e == NULL)
+    return NULL;
+
+  static bool registered = false;
+  if (!registered)
+    {
+      atexit (pool_clear);
+      registered = true;
+    }
+
+  for (int i = 0; i < 3; i++)
+    {
+      e->N[i] = PD->N[i];
+      e->L[i] = PD->L[i];
+    }
+  e->comm = comm_world_petsc;
+  fft_layout (&e->pencil, &e->transposed);
+  e->refs = 0;
+  core_make (PD, &e->core);
+
+  pool_next = (e - pool + 1) % MAX_STATES;
+
+  return e;
+}
+
+
+State* bgy3d_state_make (const ProblemData *PD)
+{
+  /*
+    FIXME: Memory limits? Accidentally  calling 3D code with a typical
+    dimension  of   1D?   Anyway,  N^3  should  not   overflow  in  3D
+    runs. Print a warning if N^3 is definitely over 2^31:
+  */
+  const int nmax = 1291;
+  if (PD->N[0] >= nmax && PD->N[1] >= nmax && PD->N[2] >= nmax)
+    FPRINTF (stderr, "Warning: grid %d x %d x %d too large for 3D!\n",
+             PD->N[0], PD->N[1], PD->N[2]);
+
+  State *BHD = malloc (sizeof *BHD);
+
+  Entry *e = pool_get (PD);
+  if (e)
+    {
+      e->refs++;
+      *BHD = e->core;
+    }
+  else
+    core_make (PD, BHD);        /* not pooled */
+
+  BHD->PD = PD;
+
+  return BHD;
+}
+
+
+void bgy3d_state_destroy (State *BHD)
+{
+  /* Pooled parts stay for the next user: */
+  for (int i = 0; i < pool_size; i++)
+    if (pool[i].core.fft_mat == BHD->fft_mat)
+      {
+        assert (pool[i].refs > 0);
+        pool[i].refs--;
+        free (BHD);
+        return;
+      }
+
+  core_destroy (comm_world_petsc, BHD);
 
   free (BHD);
 }
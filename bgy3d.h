@@ -178,11 +178,13 @@ typedef DM DA; /* At least in 2.3.3 (Lenny) there are both DM and DA */
 #define unlikely(x)  __builtin_expect (!!(x), 0)
 #define pure         __attribute__ ((const))
 #define deprecated   __attribute__ ((__deprecated__))
+#define always_inline __attribute__ ((__always_inline__))
 #else
 #define likely(x)    (x)
 #define unlikely(x)  (x)
 #define pure                    /* pure */
 #define deprecated              /* deprecated */
+#define always_inline           /* always_inline */
 #endif
 
 #if GCC_VERSION > VERSION(4, 3)
@@ -271,6 +273,26 @@ volume_element (const ProblemData *PD)
 }
 
 
+/*
+  Radial  parameters for the 1D  solvers, rmax  and nrad, derived from
+  the  3D  grid.   The  1D  solution   is  tabulated   on  the  3D grid
+  afterwards, the radial grid needs to extend beyond the box and to be
+  finer than the mesh:
+*/
+static inline ProblemData
+upscale (const ProblemData *PD)
+{
+  /*
+    FIXME: how  do we proceed if  the user specified nrad  and rmax in
+    the command line knowing better as he/she always does?
+  */
+  ProblemData pd = *PD;
+  pd.rmax = 4 * MAX (MAX (PD->L[0], PD->L[1]), PD->L[2]) / 2;
+  pd.nrad = 16 * MAX (MAX (PD->N[0], PD->N[1]), PD->N[2]);
+  return pd;
+}
+
+
 /* Get  problem data  (e.g.  from  command line)  using bgy3d_getopt_*
    interface. FIXME: implementation in bgy3d-guile.c! */
 ProblemData bgy3d_problem_data (void);
@@ -317,6 +339,8 @@ typedef struct State
 #endif
 } State;
 
+/* The DAs, FFT  and Laplacian of a State are shared with  others on
+   the same grid, see the pool in bgy3d.c: */
 State* bgy3d_state_make (const ProblemData *PD);
 void bgy3d_state_destroy (State *BHD);
 void bgy3d_problem_data_print (const ProblemData *PD);
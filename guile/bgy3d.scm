@@ -645,9 +645,11 @@ computes the sum of all vector elements."
     (rmax               (value #t)      (predicate ,string->number))
     (nrad               (value #t)      (predicate ,string->number))
     (norm-tol           (value #t)      (predicate ,string->number))
+    (single-tol         (value #t)      (predicate ,string->number)) ; float FFTs down to this norm
     (max-iter           (value #t)      (predicate ,string->number))
     (damp-start         (value #t)      (predicate ,string->number))
     (lambda             (value #t)      (predicate ,string->number))
+    (grid-levels        (value #t)      (predicate ,string->number)) ; solve on N/2, N/4, ... first
     (solvent
      (value #t)
      (predicate ,(lambda (name)
@@ -668,19 +670,43 @@ computes the sum of all vector elements."
                           y)))))
     (dielectric         (value #t)      (predicate ,string->number))
     (comb-rule          (value #t)      (predicate ,string->number))
+    (field-tol          (value #t)      (predicate ,string->number)) ; truncate solute field below this, kcal
+    (pm-tol             (value #t)      (predicate ,string->number)) ; particle-mesh form factors to this accuracy
     (solvent-3d         (value #f)) ; take χ from file computed by 3D RISM
     (no-renorm          (value #f)) ; dont do lon-range renormalization
+    (radial-kernels     (value #f)) ; χ - 1 from 1D tables on the fly, no 3D storage
     (from-radial-g2     (value #f))
+    (radial-solvent     (value #f)) ; pure solvent BGY on the radial grid
     (save-guess         (value #f))
     (save-binary        (value #f))
     (load-guess         (value #f))
+    (restart-store      (value #t)) ; directory with converged results to start from
+    (restart-extrapolate (value #t)     (predicate ,string->number)) ; order of the guess along a scan, 1 or 2
     (derivatives        (value #f))
     (response           (value #f))
+    (response-batch     (value #t)      (predicate ,string->number)) ; modes solved together
+    (response-check     (value #f)) ; compare batched response to the KSP for one mode
     (snes-solver
      (value #t)
      (predicate ,(lambda (x)
-                   (and (member x '("jager" "newton" "picard" "trial"))
+                   (and (member x '("jager" "newton" "picard" "trial" "mdiis"))
                         x))))
+    (snes-pc
+     (value #t)
+     (predicate ,(lambda (x)
+                   (and (member x '("none" "kspace"))
+                        x))))
+    (mdiis-size         (value #t)      (predicate ,string->number)) ; subspace size
+    (mdiis-restart      (value #t)      (predicate ,string->number)) ; residual growth factor
+    (fft-planner
+     (value #t)
+     (predicate ,(lambda (x)
+                   (and (member x '("estimate" "measure" "patient" "exhaustive"))
+                        x))))
+    (fft-wisdom         (value #t)) ; path prefix of FFTW wisdom file
+    (fft-pencil         (value #t)      (predicate ,string->number)) ; workers along N[1]
+    (fft-transposed     (value #f)) ; keep k-space transposed, slabs only
+    (threads            (value #t)      (predicate ,string->number)) ; per worker, with OpenMP
     (verbose            (single-char #\v)
                         (value #f)) ; use --verbosity num instead
     (rbc                (value #f)) ; add repulsive bridge correction
@@ -0,0 +1,184 @@
+/* -*- mode: c; c-basic-offset: 2; -*- vim: set sw=2 tw=70 et sta ai: */
+/*
+  Copyright (c) 2014 Alexei Matveev
+
+  Solvent  kernels  of 3D  RISM  evaluated on  the  fly,  see
+  --radial-kernels in hnc3d.c.  Both the  susceptibility χ - 1 and the
+  renormalization τ of a unit charge are radial functions of |k| that
+  come from 1D tables.   Tabulating them  on the 3D k-grid  takes m(m
+  + 1) / 2 + m complex  grids.  Here  only the  nearest table entry and
+  the interpolation weight  of each local k-point are stored,  for all
+  pairs at once.  The  only remaining 3D grid is the centered form
+  factor of the solute for τ.
+*/
+
+#include "bgy3d.h"
+#include "bgy3d-vec.h"          /* vec_ktab_index() */
+#include "bgy3d-solutes.h"      /* bgy3d_solute_form() */
+#include "hnc3d-radial.h"
+
+struct Radial
+{
+  int m, nrad;
+  real *chi;                    /* [m][m][nrad], χ - 1 */
+  real *tau;                    /* [m][nrad], or NULL */
+  int nk;                       /* local k-points */
+  int *idx;                     /* [nk], nearest table entry */
+  real *wgt;                    /* [nk], see vec_tab_value() */
+  Vec form_fft;                 /* complex, centered, or NULL */
+};
+
+
+Radial*
+hnc3d_radial_create (const State *HD, int m, int nrad, real dk,
+                     const real chi[m][m][nrad],
+                     const real tau[m][nrad],
+                     int n, const Site solute[n])
+{
+  Radial *R = malloc (sizeof *R);
+
+  R->m = m;
+  R->nrad = nrad;
+
+  R->chi = malloc (m * m * nrad * sizeof *R->chi);
+  memcpy (R->chi, chi, m * m * nrad * sizeof *R->chi);
+
+  /* Collective: */
+  local Vec v = vec_create (HD->dc);
+  R->nk = vec_local_size (v) / 2;
+
+  R->idx = malloc (R->nk * sizeof *R->idx);
+  R->wgt = malloc (R->nk * sizeof *R->wgt);
+  vec_ktab_index (HD, nrad, dk, R->idx, R->wgt);
+
+  if (tau)
+    {
+      R->tau = malloc (m * nrad * sizeof *R->tau);
+      memcpy (R->tau, tau, m * nrad * sizeof *R->tau);
+
+      /* Form factor times one, centered. Not VecSet() on complex: */
+      {
+        local complex *v_ = (complex*) vec_get_array (v);
+        for (int k = 0; k < R->nk; k++)
+          v_[k] = 1.0;
+        vec_restore_array (v, (void*) &v_);
+      }
+      bgy3d_solute_form (HD, n, solute, 1, &v);
+      R->form_fft = v;
+      v = NULL;                 /* because declared local */
+    }
+  else
+    {
+      R->tau = NULL;
+      R->form_fft = NULL;
+      vec_destroy (&v);
+    }
+
+  return R;
+}
+
+
+void
+hnc3d_radial_destroy (Radial *R)
+{
+  if (R->form_fft)
+    vec_destroy (&R->form_fft);
+
+  free (R->tau);
+  free (R->idx);
+  free (R->wgt);
+  free (R->chi);
+  free (R);
+}
+
+
+real
+hnc3d_radial_chi (const Radial *R, int i, int j, int k)
+{
+  const int nrad = R->nrad;
+  const real (*chi)[R->m][nrad] = (void*) R->chi;
+
+  return vec_tab_value (nrad, chi[i][j], R->idx[k], R->wgt[k]);
+}
+
+
+/*
+  Single pass, as in star().  The table values are real, for each
+  k-point they are interpolated once for all pairs:
+*/
+void
+hnc3d_radial_star (const Radial *R, int m, Vec x_fft[m], Vec y_fft[m])
+{
+  assert (m == R->m);
+
+  const int nrad = R->nrad;
+  const real (*chi)[m][nrad] = (void*) R->chi;
+  const int *idx = R->idx;
+  const real *wgt = R->wgt;
+
+  local complex *x_[m], *y_[m];
+  for (int i = 0; i < m; i++)
+    {
+      x_[i] = (complex*) vec_get_array (x_fft[i]);
+      y_[i] = (complex*) vec_get_array (y_fft[i]);
+    }
+
+#pragma omp parallel
+  {
+    int a, b;
+    thread_range (R->nk, &a, &b);
+
+    for (int k = a; k < b; k++)
+      {
+        real c[m][m];
+        for (int i = 0; i < m; i++)
+          for (int j = 0; j <= i; j++)
+            c[i][j] = c[j][i] = vec_tab_value (nrad, chi[i][j], idx[k], wgt[k]);
+
+        complex x[m];
+        for (int j = 0; j < m; j++)
+          x[j] = x_[j][k];
+
+        for (int i = 0; i < m; i++)
+          {
+            complex s = 0.0;
+            for (int j = 0; j < m; j++)
+              s += c[i][j] * x[j];
+            y_[i][k] = s;
+          }
+      }
+  }
+
+  for (int i = 0; i < m; i++)
+    {
+      vec_restore_array (x_fft[i], (void*) &x_[i]);
+      vec_restore_array (y_fft[i], (void*) &y_[i]);
+    }
+}
+
+
+void
+hnc3d_radial_tau (const Radial *R, real a, int i, Vec y_fft)
+{
+  assert (R->tau != NULL);
+
+  const int nrad = R->nrad;
+  const real *tau = R->tau + i * nrad;
+  const int *idx = R->idx;
+  const real *wgt = R->wgt;
+
+  local complex *f_ = (complex*) vec_get_array (R->form_fft);
+  local complex *y_ = (complex*) vec_get_array (y_fft);
+
+#pragma omp parallel
+  {
+    int p, q;
+    thread_range (R->nk, &p, &q);
+
+    for (int k = p; k < q; k++)
+      y_[k] += a * f_[k] * vec_tab_value (nrad, tau, idx[k], wgt[k]);
+  }
+
+  vec_restore_array (R->form_fft, (void*) &f_);
+  vec_restore_array (y_fft, (void*) &y_);
+}
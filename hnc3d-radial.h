@@ -0,0 +1,28 @@
+/* -*- mode: c; c-basic-offset: 2; -*- vim: set sw=2 tw=70 et sta ai: */
+/*
+  Copyright (c) 2014 Alexei Matveev
+*/
+
+typedef struct Radial Radial;   /* opaque */
+
+/*
+  Collective.  The  tables chi[][][]  (χ - 1)  and tau[][] (NULL, or
+  renormalization for a unit charge)  are on the 1D k-grid (i + 1/2)
+  dk.  They are copied.  With tau the  form  factor of the solute is
+  tabulated too:
+*/
+Radial* hnc3d_radial_create (const State *HD, int m, int nrad, real dk,
+                             const real chi[m][m][nrad],
+                             const real tau[m][nrad], /* NULL or in */
+                             int n, const Site solute[n]);
+
+void hnc3d_radial_destroy (Radial *R);
+
+/* Convolution y = (χ - 1) * x, same as star() in hnc3d.c: */
+void hnc3d_radial_star (const Radial *R, int m, Vec x_fft[m], Vec y_fft[m]);
+
+/* y += a τ  with the centered renormalization τ  of site i: */
+void hnc3d_radial_tau (const Radial *R, real a, int i, Vec y_fft);
+
+/* Value of χ - 1 for pair ij at the local k-point k: */
+real hnc3d_radial_chi (const Radial *R, int i, int j, int k);
@@ -86,3 +86,111 @@ static inline void hnc3d_sles_zgemm (int m,
   cblas_zgemm (CblasColMajor, CblasNoTrans, CblasNoTrans,
                m, m, m, &one, a, m, b, m, &zero, c, m);
 }
+
+
+/*
+  Batched versions for many small matrices at once, e.g. one for each
+  k-point. Structure  of arrays: element (i,  j) of the  matrix number
+  l is  a[j][i][l], in the same column major interpretation as above.
+  The  innermost loops run  over the batch  and vectorize. For small m
+  the  per-call overhead  of BLAS and LAPACK exceeds the  arithmetics
+  by far.  These are  meant to be inlined with a constant m, then the
+  loops over the matrix indices are unrolled completely.
+*/
+#define HNC3D_SLES_BATCH 8
+
+
+static inline real hnc3d_sles_norm2 (complex z)
+{
+  return creal (z) * creal (z) + cimag (z) * cimag (z);
+}
+
+
+/* C := A * B for each l: */
+static inline always_inline void
+hnc3d_sles_zgemm_batch (int m,
+                        complex a[m][m][HNC3D_SLES_BATCH], /* in */
+                        complex b[m][m][HNC3D_SLES_BATCH], /* in */
+                        complex c[m][m][HNC3D_SLES_BATCH]) /* out */
+{
+  enum {B = HNC3D_SLES_BATCH};
+
+  for (int j = 0; j < m; j++)
+    for (int i = 0; i < m; i++)
+      {
+        complex s[B];
+        for (int l = 0; l < B; l++)
+          s[l] = 0.0;
+
+        for (int k = 0; k < m; k++)
+          for (int l = 0; l < B; l++)
+            s[l] += a[k][i][l] * b[j][k][l];
+
+        for (int l = 0; l < B; l++)
+          c[j][i][l] = s[l];
+      }
+}
+
+
+/*
+  Solve A X = B for each l by Gauss elimination. A is destroyed, the
+  result is returned in B. Row exchanges  do not vectorize, instead
+  ok[l] is  set to false if any  pivot is smaller than one tenth of
+  the  largest candidate  in  its column, the threshold for which the
+  growth  stays  bounded.  The caller  should redo such systems with
+  hnc3d_sles_zgesv() that pivots.
+*/
+static inline always_inline void
+hnc3d_sles_zgesv_batch (int m,
+                        complex a[m][m][HNC3D_SLES_BATCH], /* inout */
+                        complex b[m][m][HNC3D_SLES_BATCH], /* inout */
+                        bool ok[HNC3D_SLES_BATCH])        /* out */
+{
+  enum {B = HNC3D_SLES_BATCH};
+
+  for (int l = 0; l < B; l++)
+    ok[l] = true;
+
+  for (int p = 0; p < m; p++)
+    {
+      real piv[B];
+      for (int l = 0; l < B; l++)
+        {
+          piv[l] = hnc3d_sles_norm2 (a[p][p][l]);
+          ok[l] &= (piv[l] > 0.0);
+        }
+
+      for (int r = p + 1; r < m; r++)
+        for (int l = 0; l < B; l++)
+          ok[l] &= (100 * piv[l] >= hnc3d_sles_norm2 (a[p][r][l]));
+
+      /* Keep the inverse of the pivot for the back substitution: */
+      for (int l = 0; l < B; l++)
+        a[p][p][l] = 1.0 / a[p][p][l];
+
+      for (int r = p + 1; r < m; r++)
+        {
+          complex f[B];
+          for (int l = 0; l < B; l++)
+            f[l] = a[p][r][l] * a[p][p][l];
+
+          for (int j = p + 1; j < m; j++)
+            for (int l = 0; l < B; l++)
+              a[j][r][l] -= f[l] * a[j][p][l];
+
+          for (int j = 0; j < m; j++)
+            for (int l = 0; l < B; l++)
+              b[j][r][l] -= f[l] * b[j][p][l];
+        }
+    }
+
+  for (int r = m - 1; r >= 0; r--)
+    for (int j = 0; j < m; j++)
+      for (int l = 0; l < B; l++)
+        {
+          complex x = b[j][r][l];
+          for (int k = r + 1; k < m; k++)
+            x -= a[k][r][l] * b[j][k][l];
+          b[j][r][l] = x * a[r][r][l];
+        }
+}
@@ -142,12 +142,14 @@
 #include "bgy3d-pure.h"         /* bgy3d_omega_fft_create() */
 #include "bgy3d-snes.h"         /* bgy3d_snes_default() */
 #include "hnc3d-sles.h"         /* hnc3d_sles_zgesv() */
+#include "hnc3d-radial.h"       /* hnc3d_radial_star() */
 #include "rism.h"               /* rism_solvent() */
 #include "bgy3d-potential.h"    /* info() */
 #include "bgy3d-impure.h"       /* Restart */
 #include "bgy3d-solvents.h"     /* bgy3d_sites_show() */
 #include "bgy3d-guile.h"        /* from_double2() */
 #include <math.h>               /* expm1() */
+#include <float.h>              /* FLT_EPSILON */
 #include "hnc3d.h"
 
 
@@ -226,6 +228,133 @@ compute_t2_1 (real rho, Vec c_fft, Vec t_fft)
 }
 
 
+/*
+  Solve the OZ equation for a single momentum k, see compute_t2_m().
+  Here t_[i][j][k] is set for j <= i only:
+*/
+static void
+oz_point (int m, real rho, int k,
+          complex *c_[m][m], complex *w_[m][m], complex *t_[m][m])
+{
+  complex H[m][m], C[m][m], W[m][m], WC[m][m], T[m][m];
+
+  /* for j <= i only: */
+  for (int i = 0; i < m; i++)
+    for (int j = 0; j <= i; j++)
+      {
+        /*
+          Extract C  and W for  this particular momentum  k from
+          scattered arrays into contiguous matrices.
+        */
+        C[i][j] = C[j][i] = c_[i][j][k];
+
+        /* Diagonal is implicitly 1: */
+        W[i][j] = W[j][i] = (i == j) ? 1.0 : w_[i][j][k];
+      }
+
+  /* WC,  an  intermediate.  See  comment  on  layout of  result
+     below.  The input is symmetric, though: */
+  hnc3d_sles_zgemm (m, W, C, WC);
+
+  /* T :=  1 - ρWC.  The  matrix T is  used here as a  free work
+     array: */
+  for (int i = 0; i < m; i++)
+    for (int j = 0; j < m; j++)
+      T[i][j] = delta (i, j) - rho * WC[i][j];
+
+  /*
+    H := WCW.  Temporarily ---  it will be overwritten with the
+    real H  after solving the  linear equations.
+
+    Note that  the matrix multiplication is  performed using the
+    Fortran  (column major) interpetation  of the  matrix memory
+    layout. In Fortran notation:
+
+      H(i, j) = Σ  WC(i, k) * W(k, j)
+                 k
+
+    or, in C-notation:
+
+      H[j][i] = Σ  WC[k][i] * W[j][k]
+                 k
+  */
+  hnc3d_sles_zgemm (m, WC, W, H);
+
+  /*
+    Solving the linear equation makes H have the literal meaning
+    of the total correlation matrix (input T is destroyed):
+
+          -1                -1
+    H := T   * H == (1 - ρc)   * c
+  */
+  hnc3d_sles_zgesv (m, T, H);
+
+
+  /*
+    The  same  effect  is  achieved  in  1x1  version  of  the  code
+    differently:
+
+    T := H - C
+  */
+  for (int i = 0; i < m; i++)
+    for (int j = 0; j <= i; j++)
+      t_[i][j][k] = H[i][j] - C[i][j];
+}
+
+
+/*
+  Same as oz_point() for  the batch of momenta k0 <= k < k0 + B, see
+  hnc3d_sles_zgesv_batch().  Inlined for each small m separately. The
+  systems  that are  unsafe without pivoting are  redone by oz_point()
+  which is rare:
+*/
+static inline always_inline void
+oz_batch (int m, real rho, int k0, int nk,
+          complex *c_[m][m], complex *w_[m][m], complex *t_[m][m])
+{
+  enum {B = HNC3D_SLES_BATCH};
+  complex H[m][m][B], C[m][m][B], W[m][m][B], WC[m][m][B], T[m][m][B];
+  bool ok[B];
+
+  /* The tail of the last batch repeats the last momentum: */
+  int kk[B];
+  for (int l = 0; l < B; l++)
+    kk[l] = (k0 + l < nk) ? k0 + l : nk - 1;
+
+  for (int i = 0; i < m; i++)
+    for (int j = 0; j <= i; j++)
+      for (int l = 0; l < B; l++)
+        {
+          C[i][j][l] = C[j][i][l] = c_[i][j][kk[l]];
+          W[i][j][l] = W[j][i][l] = (i == j) ? 1.0 : w_[i][j][kk[l]];
+        }
+
+  hnc3d_sles_zgemm_batch (m, W, C, WC);
+
+  for (int i = 0; i < m; i++)
+    for (int j = 0; j < m; j++)
+      for (int l = 0; l < B; l++)
+        T[i][j][l] = delta (i, j) - rho * WC[i][j][l];
+
+  hnc3d_sles_zgemm_batch (m, WC, W, H);
+
+  hnc3d_sles_zgesv_batch (m, T, H, ok);
+
+  for (int l = 0; l < B && k0 + l < nk; l++)
+    {
+      if (unlikely (!ok[l]))
+        {
+          oz_point (m, rho, k0 + l, c_, w_, t_);
+          continue;
+        }
+
+      for (int i = 0; i < m; i++)
+        for (int j = 0; j <= i; j++)
+          t_[i][j][k0 + l] = H[i][j][l] - C[i][j][l];
+    }
+}
+
+
 /* So far rho is scalar, it could be different for all sites: */
 static void
 compute_t2_m (int m, real rho, Vec c_fft[m][m], Vec w_fft[m][m], Vec t_fft[m][m])
@@ -245,74 +374,37 @@ compute_t2_m (int m, real rho, Vec c_fft[m][m], Vec w_fft[m][m], Vec t_fft[m][m]
   const int n = vec_local_size (c_fft[0][0]);
   assert (n % 2 == 0);
 
-  {
-    complex H[m][m], C[m][m], W[m][m], WC[m][m], T[m][m];
+  /*
+    Momenta  are  independent,  with  OpenMP  the batches  are  shared
+    among threads.  A batch  of B momenta is solved at once by kernels
+    specialized for constant m. LAPACK is used for larger m:
+  */
+  const int nk = n / 2;
+  const int B = HNC3D_SLES_BATCH;
 
-    for (int k = 0; k < n / 2; k++)
+#pragma omp parallel for
+  for (int k0 = 0; k0 < nk; k0 += B)
+    switch (m)
       {
-        /* for j <= i only: */
-        for (int i = 0; i < m; i++)
-          for (int j = 0; j <= i; j++)
-            {
-              /*
-                Extract C  and W for  this particular momentum  k from
-                scattered arrays into contiguous matrices.
-              */
-              C[i][j] = C[j][i] = c_fft_[i][j][k];
-
-              /* Diagonal is implicitly 1: */
-              W[i][j] = W[j][i] = (i == j) ? 1.0 : w_fft_[i][j][k];
-            }
-
-        /* WC,  an  intermediate.  See  comment  on  layout of  result
-           below.  The input is symmetric, though: */
-        hnc3d_sles_zgemm (m, W, C, WC);
-
-        /* T :=  1 - ρWC.  The  matrix T is  used here as a  free work
-           array: */
-        for (int i = 0; i < m; i++)
-          for (int j = 0; j < m; j++)
-            T[i][j] = delta (i, j) - rho * WC[i][j];
-
-        /*
-          H := WCW.  Temporarily ---  it will be overwritten with the
-          real H  after solving the  linear equations.
-
-          Note that  the matrix multiplication is  performed using the
-          Fortran  (column major) interpetation  of the  matrix memory
-          layout. In Fortran notation:
-
-            H(i, j) = Σ  WC(i, k) * W(k, j)
-                       k
-
-          or, in C-notation:
-
-            H[j][i] = Σ  WC[k][i] * W[j][k]
-                       k
-        */
-        hnc3d_sles_zgemm (m, WC, W, H);
-
-        /*
-          Solving the linear equation makes H have the literal meaning
-          of the total correlation matrix (input T is destroyed):
-
-                -1                -1
-          H := T   * H == (1 - ρc)   * c
-        */
-        hnc3d_sles_zgesv (m, T, H);
-
-
-        /*
-          The  same  effect  is  achieved  in  1x1  version  of  the  code
-          differently:
-
-          T := H - C
-        */
-        for (int i = 0; i < m; i++)
-          for (int j = 0; j <= i; j++)
-            t_fft_[i][j][k] = H[i][j] - C[i][j];
+      case 2:
+        oz_batch (2, rho, k0, nk, c_fft_, w_fft_, t_fft_);
+        break;
+      case 3:
+        oz_batch (3, rho, k0, nk, c_fft_, w_fft_, t_fft_);
+        break;
+      case 4:
+        oz_batch (4, rho, k0, nk, c_fft_, w_fft_, t_fft_);
+        break;
+      case 5:
+        oz_batch (5, rho, k0, nk, c_fft_, w_fft_, t_fft_);
+        break;
+      case 6:
+        oz_batch (6, rho, k0, nk, c_fft_, w_fft_, t_fft_);
+        break;
+      default:
+        for (int k = k0; k < k0 + B && k < nk; k++)
+          oz_point (m, rho, k, c_fft_, w_fft_, t_fft_);
       }
-  }
 
   /* Here vec_restore_array2() expects array  of real*, we offer array
      of complex* instead: */
@@ -769,20 +861,6 @@ print_kappa (const State *HD, int n, int m, Vec c[n][m])
 }
 
 
-static inline ProblemData
-upscale (const ProblemData *PD)
-{
-  /*
-    FIXME: how  do we proceed if  the user specified nrad  and rmax in
-    the command line knowing better as he/she always does?
-  */
-  ProblemData pd = *PD;
-  pd.rmax = 4 * MAX (MAX (PD->L[0], PD->L[1]), PD->L[2]) / 2;
-  pd.nrad = 16 * MAX (MAX (PD->N[0], PD->N[1]), PD->N[2]);
-  return pd;
-}
-
-
 /*
   Solving for indirect correlation t = h - c and thus, also for direct
   correlation c  and other quantities  of HNC equation.   The indirect
@@ -1115,25 +1193,46 @@ static void
 star (int m, Vec a_fft[m][m], Vec x_fft[m], Vec y_fft[m])
 {
   /*
-    FMA stays for "fused multiply-add".  This is an elementary step of
-    the matrix multiplication is
+    A single pass over all arrays. For each momentum the sum
+
+      y  = Σ  A  * x
+       i   j   ij   j
 
-      y  += A  * x
-       i     ij   j
+    is accumulated in  registers, instead of m + m² passes with VecSet()
+    and  one  fused  multiply-add  per  pair.   The  matrix  A  is
+    symmetric with aliased Vecs as created by vec_create2():
   */
-  void fma (int n, complex y[n], complex a[n], complex x[n])
+  local complex *a_[m][m], *x_[m], *y_[m];
+
+  vec_get_array2 (m, a_fft, (void*) a_);
+  for (int i = 0; i < m; i++)
+    {
+      x_[i] = (complex*) vec_get_array (x_fft[i]);
+      y_[i] = (complex*) vec_get_array (y_fft[i]);
+    }
+
+  const int n = vec_local_size (x_fft[0]) / 2;
+
+#pragma omp parallel
   {
-    for (int i = 0; i < n; i++)
-      y[i] += a[i] * x[i];
+    int a, b;
+    thread_range (n, &a, &b);
+
+    for (int i = 0; i < m; i++)
+      for (int k = a; k < b; k++)
+        {
+          complex s = 0.0;
+          for (int j = 0; j < m; j++)
+            s += a_[i][j][k] * x_[j][k];
+          y_[i][k] = s;
+        }
   }
 
-  /* For each solvent site ... */
+  vec_restore_array2 (m, a_fft, (void*) a_);
   for (int i = 0; i < m; i++)
     {
-      /* ... sum over solvent sites: */
-      VecSet (y_fft[i], 0.0);
-      for (int j = 0; j < m; j++)
-        vec_fft_app3 (fma, y_fft[i], a_fft[i][j], x_fft[j]);
+      vec_restore_array (x_fft[i], (void*) &x_[i]);
+      vec_restore_array (y_fft[i], (void*) &y_[i]);
     }
 }
 
@@ -1170,9 +1269,31 @@ typedef struct Ctx1
   Vec *c_fft, *t_fft;           /* [m], complex, work */
   Vec *chi_fft;                 /* [m][m], complex, fixed */
   Vec *tau_fft;                 /* [m], complex, fixed */
+  Radial *radial;               /* NULL, or instead of the two above */
+  real *alpha;                  /* [m], see precond_t1() */
+  int k;                        /* max batch, see jacobian_t1_many() */
+  Vec *c_many;                  /* [k][m], real, work */
+  Vec *c_fft_many, *t_fft_many; /* [k][m], complex, work */
+  bool check;                   /* --response-check, see response_t1() */
 } Ctx1;
 
 
+/*
+  y = (χ - 1) * x  either with χ - 1 tabulated on the 3D grid, or with
+  --radial-kernels evaluated on the fly from the 1D tables:
+*/
+static void
+kernel_star (const Ctx1 *ctx, Vec x_fft[], Vec y_fft[])
+{
+  const int m = ctx->m;
+
+  if (ctx->radial)
+    hnc3d_radial_star (ctx->radial, m, x_fft, y_fft);
+  else
+    star (m, (void*) ctx->chi_fft, x_fft, y_fft);
+}
+
+
 /*
   Implements the objective function for non-linear solver:
 
@@ -1183,9 +1304,7 @@ typedef struct Ctx1
 static void
 iterate_t1 (Ctx1 *ctx, Vec T, Vec dT)
 {
-  /* alias of the right shape: */
   const int m = ctx->m;
-  Vec (*chi_fft)[m] = (void*) ctx->chi_fft; /* [m][m], complex, in */
 
   const ProblemData *PD = ctx->HD->PD;
   const real beta = PD->beta;
@@ -1202,13 +1321,17 @@ iterate_t1 (Ctx1 *ctx, Vec T, Vec dT)
     closure relation:
   */
   for (int i = 0; i < m; i++)
-    {
-      compute_c (PD->closure, beta, ctx->v_short[i], t[i], ctx->c[i]);
+    compute_c (PD->closure, beta, ctx->v_short[i], t[i], ctx->c[i]);
 
-      /* fft(c).  Here  c is the  3d unknown direct  uv-correlation of
-         the solvent sites and the solute species as the whole: */
-      MatMult (ctx->HD->fft_mat, ctx->c[i], ctx->c_fft[i]);
+  /*
+    fft(c).  Here c is the 3d unknown direct uv-correlation of the
+    solvent sites and the solute species as the whole. All m sites are
+    transformed in one batch:
+  */
+  bgy3d_fft_mat_mult_many (ctx->HD->fft_mat, m, ctx->c, ctx->c_fft);
 
+  for (int i = 0; i < m; i++)
+    {
       /* scaling by h^3 in forward FFT */
       VecScale (ctx->c_fft[i], h3);
 
@@ -1242,7 +1365,7 @@ iterate_t1 (Ctx1 *ctx, Vec T, Vec dT)
     result by L^3 in backward FFT, replace  1.0 / N3 as 1.0 ( 1.0 / N3
     = h^3 / L^3 )
   */
-  star (m, chi_fft, ctx->c_fft, ctx->t_fft);
+  kernel_star (ctx, ctx->c_fft, ctx->t_fft);
 
   /* t = fft^-1 (fft(c) * fft(h)). Here t is 3d t1. */
   for (int i = 0; i < m; i++)
@@ -1257,16 +1380,19 @@ iterate_t1 (Ctx1 *ctx, Vec T, Vec dT)
           T := T - βV
            S         L
       */
-      if (ctx->renorm)
+      if (ctx->renorm && ctx->radial)
+        hnc3d_radial_tau (ctx->radial, -beta * EPSILON0INV, i, ctx->t_fft[i]);
+      else if (ctx->renorm)
         VecAXPY (ctx->t_fft[i], -beta * EPSILON0INV, ctx->tau_fft[i]);
       else
         VecAXPY (ctx->t_fft[i], -beta * ctx->charge[i], ctx->v_long_fft);
+    }
 
-      MatMultTranspose (ctx->HD->fft_mat, ctx->t_fft[i], dt[i]);
+  bgy3d_fft_mat_mult_transpose_many (ctx->HD->fft_mat, m, ctx->t_fft, dt);
 
-      /* Scaling by inverse volume factor in backward FFT */
-      VecScale (dt[i], 1.0 / L3);
-    }
+  /* Scaling by inverse volume factor in backward FFT */
+  for (int i = 0; i < m; i++)
+    VecScale (dt[i], 1.0 / L3);
 
 
   /*
@@ -1291,7 +1417,6 @@ jacobian_t1 (Ctx1 *ctx, Vec T, Vec dT, Vec JdT)
 {
   /* See iterate_t1() above! */
   const int m = ctx->m;
-  Vec (*chi_fft)[m] = (void*) ctx->chi_fft; /* [m][m], complex, in */
 
   const ProblemData *PD = ctx->HD->PD;
   const real beta = PD->beta;
@@ -1319,26 +1444,26 @@ jacobian_t1 (Ctx1 *ctx, Vec T, Vec dT, Vec JdT)
       */
       if (ctx->flag)
         VecAXPY (ctx->c[i], 1.0, dt[i]);
+    }
 
-      /* Re-use ctx->c_fft[] work array for dc(k): */
-      MatMult (ctx->HD->fft_mat, ctx->c[i], ctx->c_fft[i]);
+  /* Re-use ctx->c_fft[] work array for dc(k): */
+  bgy3d_fft_mat_mult_many (ctx->HD->fft_mat, m, ctx->c, ctx->c_fft);
 
-      VecScale (ctx->c_fft[i], h3);
-    }
+  for (int i = 0; i < m; i++)
+    VecScale (ctx->c_fft[i], h3);
 
   /* Re-use ctx->t_fft[] work array for (χ - 1) * dc: */
-  star (m, chi_fft, ctx->c_fft, ctx->t_fft);
+  kernel_star (ctx, ctx->c_fft, ctx->t_fft);
 
-  /* t = fft^-1 (fft(c) * fft(h)). Here t is 3d t1. */
-  for (int i = 0; i < m; i++)
-    {
-      /* Put J'  * dT  = (χ -  1) *  dc into the  Vec provided  by the
-         solver: */
-      MatMultTranspose (ctx->HD->fft_mat, ctx->t_fft[i], jdt[i]);
+  /*
+    t = fft^-1 (fft(c) * fft(h)). Here t is 3d t1.  Put J' * dT = (χ -
+    1) * dc into the Vec provided by the solver:
+  */
+  bgy3d_fft_mat_mult_transpose_many (ctx->HD->fft_mat, m, ctx->t_fft, jdt);
 
-      /* Scaling by inverse volume factor in backward FFT */
-      VecScale (jdt[i], 1.0 / L3);
-    }
+  /* Scaling by inverse volume factor in backward FFT */
+  for (int i = 0; i < m; i++)
+    VecScale (jdt[i], 1.0 / L3);
 
   vec_aliases_destroy1 (T, m, t);
   vec_aliases_destroy1 (dT, m, dt);
@@ -1362,18 +1487,214 @@ jacobian_t1 (Ctx1 *ctx, Vec T, Vec dT, Vec JdT)
 }
 
 
-/* XXX: */
+/*
+  Preconditioner  for  the Newton-Krylov  solver, see  --snes-pc  in
+  bgy3d_snes_newton_pc().  Must have the interface of VecFunc2.  The
+  Jacobian
+
+    J = (χ - 1) * c'(t) - 1
+
+  is approximated by replacing the derivative of the closure c'(t), a
+  diagonal in real space, by its average  α over the cell. In k-space
+  the approximation is then  an m x m matrix  for each k, applied by
+  one FFT pair:
+
+     -1     -1             -1
+    J   ≈  F   [(χ - 1) α - 1]   F
+
+  With dT == NULL only set up α at T:
+*/
+static void
+precond_t1 (Ctx1 *ctx, Vec T, Vec dT, Vec PdT)
+{
+  const int m = ctx->m;
+  Vec (*chi_fft)[m] = (void*) ctx->chi_fft; /* [m][m], complex, in */
+
+  const ProblemData *PD = ctx->HD->PD;
+  const real beta = PD->beta;
+
+  if (dT == NULL)
+    {
+      local Vec t[m];
+      vec_aliases_create1 (T, m, t);
+
+      /* Response of c(t) to δt = 1 everywhere is c'(t): */
+      local Vec one = vec_duplicate (t[0]);
+      VecSet (one, 1.0);
+
+      for (int i = 0; i < m; i++)
+        {
+          compute_c1 (PD->closure, beta, ctx->v_short[i], t[i], one, ctx->c[i]);
+          ctx->alpha[i] = vec_sum (ctx->c[i]) / vec_size (ctx->c[i]);
+        }
+
+      vec_destroy (&one);
+      vec_aliases_destroy1 (T, m, t);
+      return;
+    }
+
+  local Vec x[m], y[m];
+  vec_aliases_create1 (dT, m, x);
+  vec_aliases_create1 (PdT, m, y);
+
+  bgy3d_fft_mat_mult_many (ctx->HD->fft_mat, m, x, ctx->c_fft);
+
+  {
+    /* With --radial-kernels there is no 3D χ - 1: */
+    const Radial *radial = ctx->radial;
+
+    local complex *chi_[m][m], *x_[m], *y_[m];
+
+    if (radial)
+      chi_[0][0] = NULL;        /* because declared local */
+    else
+      vec_get_array2 (m, chi_fft, (void*) chi_);
+    for (int i = 0; i < m; i++)
+      {
+        x_[i] = (complex*) vec_get_array (ctx->c_fft[i]);
+        y_[i] = (complex*) vec_get_array (ctx->t_fft[i]);
+      }
+
+    /* Unnormalized FFT pair: */
+    const real scale = 1.0 / ((real) PD->N[0] * PD->N[1] * PD->N[2]);
+    const real *alpha = ctx->alpha;
+    const int n = vec_local_size (ctx->c_fft[0]) / 2;
+
+#pragma omp parallel for
+    for (int k = 0; k < n; k++)
+      {
+        /* Column major for LAPACK, A[j][i] is A(i, j): */
+        complex A[m][m], b[m];
+        for (int i = 0; i < m; i++)
+          {
+            for (int j = 0; j < m; j++)
+              {
+                const complex chi = (radial ?
+                                     hnc3d_radial_chi (radial, i, j, k) :
+                                     chi_[i][j][k]);
+                A[j][i] = chi * alpha[j] - delta (i, j);
+              }
+            b[i] = x_[i][k];
+          }
+
+        const int one = 1;
+        int ipiv[m], info;
+        zgesv_ (&m, &one, (complex*) A, &m, ipiv, b, &m, &info);
+
+        /* Hardly ever singular, then fall back to J ≈ -1: */
+        for (int i = 0; i < m; i++)
+          y_[i][k] = scale * (info == 0 ? b[i] : -x_[i][k]);
+      }
+
+    if (!radial)
+      vec_restore_array2 (m, chi_fft, (void*) chi_);
+    for (int i = 0; i < m; i++)
+      {
+        vec_restore_array (ctx->c_fft[i], (void*) &x_[i]);
+        vec_restore_array (ctx->t_fft[i], (void*) &y_[i]);
+      }
+  }
+
+  bgy3d_fft_mat_mult_transpose_many (ctx->HD->fft_mat, m, ctx->t_fft, y);
+
+  vec_aliases_destroy1 (dT, m, x);
+  vec_aliases_destroy1 (PdT, m, y);
+}
+
+
+/*
+  Same as jacobian_t1() for k directions dT[] at the same point T. The
+  k x m FFTs each way are done in one batch:
+*/
+static void
+jacobian_t1_many (Ctx1 *ctx, Vec T, int k, Vec dT[k], Vec JdT[k])
+{
+  const int m = ctx->m;
+  State *HD = ctx->HD;
+
+  const ProblemData *PD = HD->PD;
+  const real beta = PD->beta;
+  const real h3 = volume_element (PD);
+  const real L3 = volume (PD);
+
+  /* Work arrays for  all directions, allocated once for the largest
+     batch, see the caller of response_t1(): */
+  assert (k <= ctx->k);
+  Vec (*c)[m] = (void*) ctx->c_many;
+  Vec (*c_fft)[m] = (void*) ctx->c_fft_many;
+  Vec (*t_fft)[m] = (void*) ctx->t_fft_many;
+
+  {
+    local Vec t[m];
+    vec_aliases_create1 (T, m, t);
+
+    for (int q = 0; q < k; q++)
+      {
+        local Vec dt[m];
+        vec_aliases_create1 (dT[q], m, dt);
+
+        /* See jacobian_t1() for the flag: */
+        for (int i = 0; i < m; i++)
+          {
+            compute_c1 (PD->closure, beta, ctx->v_short[i], t[i], dt[i], c[q][i]);
+            if (ctx->flag)
+              VecAXPY (c[q][i], 1.0, dt[i]);
+          }
+
+        vec_aliases_destroy1 (dT[q], m, dt);
+      }
+
+    vec_aliases_destroy1 (T, m, t);
+  }
+
+  bgy3d_fft_mat_mult_many (HD->fft_mat, k * m, (void*) c, (void*) c_fft);
+
+  for (int q = 0; q < k; q++)
+    {
+      for (int i = 0; i < m; i++)
+        VecScale (c_fft[q][i], h3);
+
+      kernel_star (ctx, c_fft[q], t_fft[q]);
+    }
+
+  {
+    local Vec jdt[k][m];
+    for (int q = 0; q < k; q++)
+      vec_aliases_create1 (JdT[q], m, jdt[q]);
+
+    bgy3d_fft_mat_mult_transpose_many (HD->fft_mat, k * m, (void*) t_fft, (void*) jdt);
+
+    for (int q = 0; q < k; q++)
+      {
+        for (int i = 0; i < m; i++)
+          VecScale (jdt[q][i], 1.0 / L3);
+
+        vec_aliases_destroy1 (JdT[q], m, jdt[q]);
+      }
+  }
+
+  if (!ctx->flag)
+    for (int q = 0; q < k; q++)
+      VecAXPY (JdT[q], -1.0, dT[q]);
+}
+
+
+/*
+  Linear response  δt  of the solution T to k  changes of the solute
+  field δv  at once.  All Jacobian  applications, those for  the RHS
+  and those of the Krylov solver, are batched over the k directions,
+  see bgy3d_krylov_many().
+*/
 static void
-response_t1 (Ctx1 *ctx, Vec T, Vec dV, Vec dT)
+response_t1 (Ctx1 *ctx, Vec T, int k, Vec dV[k], Vec dT[k])
 {
   const ProblemData *PD = ctx->HD->PD;
   const real beta = PD->beta;
-  PRINTF ("XXX: |dV| = %f\n", vec_norm (dV));
-  PRINTF ("XXX: |T0| = %f\n", vec_norm (T));
-  PRINTF ("XXX: <T0> = %f\n", vec_sum (T) * volume_element (PD));
 
-  /* RHS for the linear equation system: */
-  local Vec B = vec_duplicate (T);
+  /* RHS for the linear equation systems: */
+  local Vec B[k];
+  for (int q = 0; q < k; q++)
+    B[q] = vec_duplicate (T);
 
   /*
     Compute δF  = ∂F/∂v * δv,  the immediate change  of the non-linear
@@ -1392,32 +1713,58 @@ response_t1 (Ctx1 *ctx, Vec T, Vec dV, Vec dT)
   */
   assert (!ctx->flag);   /* we restore it to false, unconditionally */
   ctx->flag = true;
-  jacobian_t1 (ctx, T, dV, B);  /* or jacobian_t0(ctx, dV, B)) */
+  jacobian_t1_many (ctx, T, k, dV, B);
   ctx->flag = false;
 
   /*
     Now b = [(χ - 1) * δh/δt] δv.  FIXME: only for some closures δh/δv
     = -β δh/δt.
   */
-  VecScale (B, +beta);
+  for (int q = 0; q < k; q++)
+    VecScale (B[q], +beta);
 
-  PRINTF ("XXX: |B| = %f\n", vec_norm (B));
   /*
-    Now solve the equation J δt =  b or with some reformulation J δx =
+    Now solve the equations J δt =  b or with some reformulation J δx =
     βδv.  This is the linear operation, y  = J x, as a closure of more
     general J(T) over converged T:
   */
-  void jacobian_t0 (Ctx1 *ctx, Vec X, Vec Y)
+  void jacobian_t0 (Ctx1 *ctx, int k, Vec X[k], Vec Y[k])
   {
-    jacobian_t1 (ctx, T, X, Y);
+    jacobian_t1_many (ctx, T, k, X, Y);
   }
+
   /* Initial value may matter for iterative solvers: */
-  VecSet (dT, 0.0);
-  bgy3d_krylov (ctx, (VecFunc1) jacobian_t0, B, dT);
-  PRINTF ("XXX: |dT| = %f\n", vec_norm (dT));
-  PRINTF ("XXX: <dT> = %f\n", vec_sum (dT) * volume_element (PD));
+  for (int q = 0; q < k; q++)
+    VecSet (dT[q], 0.0);
+
+  bgy3d_krylov_many (ctx, (VecFuncN) jacobian_t0, k, B, dT);
 
-  vec_destroy (&B);
+  /*
+    Compare the first mode to the KSP solution, with --response-check.
+    Once, for the first batch only:
+  */
+  if (ctx->check)
+    {
+      ctx->check = false;
+
+      void jacobian_t0_1 (Ctx1 *ctx, Vec x, Vec y)
+      {
+        jacobian_t1 (ctx, T, x, y);
+      }
+
+      local Vec x = vec_duplicate (T);
+      VecSet (x, 0.0);
+      bgy3d_krylov (ctx, (VecFunc1) jacobian_t0_1, B[0], x);
+
+      const real norm = vec_norm2 (dT[0]);
+      VecAXPY (x, -1.0, dT[0]);
+      PRINTF ("# |dt - dt(KSP)| / |dt| = %e\n",
+              (norm > 0.0 ? vec_norm2 (x) / norm : vec_norm2 (x)));
+      vec_destroy (&x);
+    }
+
+  for (int q = 0; q < k; q++)
+    vec_destroy (&B[q]);
 }
 
 
@@ -1437,13 +1784,18 @@ solvent_kernel_file (int m, Vec chi_fft[m][m]) /* out */
 }
 
 
-/* Layed off  from solvent_kernel().  Puts χ -  1 into  chi_fft[][] as
-   computed by 1d RISM solvent solver. See ./rism.f90. */
+/*
+  Layed off from solvent_kernel_rism().  Returns the 1D tables of χ -
+  1 and  of the renormalization τ  on the k-grid (i  + 1/2) dk  as
+  computed by 1d RISM solvent solver,  see ./rism.f90.  The caller is
+  supposed to free() *chi and *tau.   Uncached, see solvent_tables()
+  below:
+*/
 static void
-solvent_kernel_rism (State *HD, int m, const Site solvent[m], /* in */
-                     const real *chi_fft_buf, /* NULL, or [m][m][nrad] */
-                     Vec chi_fft[m][m],       /* out, corner */
-                     Vec tau_fft[m])          /* out, corner */
+solvent_tables1 (State *HD, int m, const Site solvent[m], /* in */
+                const real *chi_fft_buf, /* NULL, or [m][m][nrad] */
+                int *nrad_, real *dk_,   /* out */
+                real **chi, real **tau)  /* out, [m][m][nrad], [m][nrad] */
 {
   bool caller_supplied_chi = (chi_fft_buf != NULL);
   int nrad;
@@ -1495,7 +1847,7 @@ solvent_kernel_rism (State *HD, int m, const Site solvent[m], /* in */
     }
 
   /* 1D versions of tau_fft[]: */
-  real t_fft[m][nrad];
+  real (*t_fft)[nrad] = malloc (m * nrad * sizeof (real));
 
   /*
     Ask the 1D code to compute T[v] + v = χ * v for a Coulomb field of
@@ -1514,7 +1866,244 @@ solvent_kernel_rism (State *HD, int m, const Site solvent[m], /* in */
     about the 1D grid:  the lowest k is dk/2 where dr *  dk = π / nrad
     and dr = rmax / nrad:
   */
-  const real dk = M_PI / rmax;
+  *dk_ = M_PI / rmax;
+  *nrad_ = nrad;
+
+  double (*const view)[m][m][nrad] = (void*) chi_fft_buf;
+
+  /*
+    The solute/solvent code expects χ -  1.  Offset the diagonal.
+  */
+  real (*x_fft)[m][nrad] = malloc (m * m * nrad * sizeof (real));
+  for (int i = 0; i < m; i++)
+    for (int j = 0; j < m; j++)
+      for (int k = 0; k < nrad; k++)
+        x_fft[i][j][k] = (*view)[i][j][k] - delta (i, j);
+
+  if (!caller_supplied_chi)
+    free ((void*) chi_fft_buf);
+
+  *chi = (void*) x_fft;
+  *tau = (void*) t_fft;
+}
+
+
+/*
+  Solvent kernels are cached.  In QM/MM SCF cycles and geometry scans
+  the solvent, the grid and the temperature stay the same from one
+  solute solve  to the next. Re-running  the 1D RISM solvent  and
+  re-tabulating the result on the 3D k-grid every time is a waste.
+  A few recent kernels are  kept, one per key,  so that the coarse
+  and fine solves of --grid-levels  each find their own.  The key is
+  what the 1D  solver sees: the solvent sites, the  radial grid as
+  chosen by solvent_tables1(), the  remaining problem data, the
+  settings,  the  solvent susceptibility  supplied by  the caller, if
+  any, and the  communicator.  The 3D grid  itself is not part of
+  the key.   Only the 1D tables  are kept.  Tabulating them on the 3D
+  grid is  cheap compared to the solute  solve, and a cached copy of
+  the 3D tables would double the memory of the largest objects.
+*/
+typedef struct
+{
+  int m;
+  Site *solvent;                /* [m] */
+  ProblemData pd;               /* copy of *HD->PD */
+  SCM settings;                 /* protected from GC */
+  real *buf;                    /* [m][m][nrad] or NULL, chi_fft_buf */
+  MPI_Comm comm;
+
+  int nrad;                     /* radial grid as used, see radial_grid() */
+  real rmax;
+  real dk;
+  real *chi, *tau;              /* [m][m][nrad], [m][nrad] */
+} Kernel;
+
+/* FIFO eviction when full: */
+#define MAX_KERNELS 4
+static Kernel *kernels[MAX_KERNELS];
+static int kernels_size = 0, kernels_next = 0;
+
+
+/*
+  The radial grid  of the 1D solver  in solvent_tables1(): as supplied
+  with the  susceptibility by  the caller, otherwise derived from the
+  3D grid by upscale():
+*/
+static void
+radial_grid (const ProblemData *PD, const real *chi_fft_buf,
+             int *nrad, real *rmax)
+{
+  if (chi_fft_buf != NULL)
+    {
+      *nrad = PD->nrad;
+      *rmax = PD->rmax;
+    }
+  else
+    {
+      const ProblemData pd = upscale (PD);
+      *nrad = pd.nrad;
+      *rmax = pd.rmax;
+    }
+}
+
+
+static void
+kernel_free (Kernel *K)
+{
+  scm_gc_unprotect_object (K->settings);
+  free (K->solvent);
+  free (K->buf);
+  free (K->chi);
+  free (K->tau);
+  free (K);
+}
+
+
+/*
+  Also run by exit(). Registered  after finalize() in bgy3d-guile.c, so
+  it runs before PetscFinalize():
+*/
+static void
+kernel_clear (void)
+{
+  for (int i = 0; i < kernels_size; i++)
+    kernel_free (kernels[i]);
+
+  kernels_size = 0;
+  kernels_next = 0;
+}
+
+
+static bool
+kernel_match (const Kernel *K, State *HD, int m, const Site solvent[m],
+              const real *chi_fft_buf)
+{
+  if (K->m != m || K->comm != comm_world_petsc)
+    return false;
+
+  int nrad;
+  real rmax;
+  radial_grid (HD->PD, chi_fft_buf, &nrad, &rmax);
+
+  if (K->nrad != nrad || K->rmax != rmax)
+    return false;
+
+  /* Grid N[], L[] and the redundant h[] are not compared: */
+  const ProblemData *a = &K->pd, *b = HD->PD;
+  if (a->beta != b->beta || a->rho != b->rho ||
+      a->lambda != b->lambda || a->damp != b->damp ||
+      a->max_iter != b->max_iter || a->norm_tol != b->norm_tol ||
+      a->closure != b->closure)
+    return false;
+
+  for (int i = 0; i < m; i++)
+    {
+      const Site *x = &K->solvent[i], *y = &solvent[i];
+      if (strncmp (x->name, y->name, sizeof x->name) ||
+          x->x[0] != y->x[0] || x->x[1] != y->x[1] || x->x[2] != y->x[2] ||
+          x->sigma != y->sigma || x->epsilon != y->epsilon ||
+          x->charge != y->charge)
+        return false;
+    }
+
+  /* Caller supplied susceptibility has the shape [m][m][pd.nrad]: */
+  if ((K->buf == NULL) != (chi_fft_buf == NULL))
+    return false;
+  if (K->buf && memcmp (K->buf, chi_fft_buf, m * m * b->nrad * sizeof (real)))
+    return false;
+
+  /* Options other than the problem data are read from the settings: */
+  return scm_is_true (scm_equal_p (K->settings, guile_get_settings ()));
+}
+
+
+/* Returns the cached kernel for these arguments, computes it if not
+   yet there: */
+static Kernel*
+kernel_get (State *HD, int m, const Site solvent[m],
+            const real *chi_fft_buf)
+{
+  for (int i = 0; i < kernels_size; i++)
+    if (kernel_match (kernels[i], HD, m, solvent, chi_fft_buf))
+      return kernels[i];
+
+  static bool registered = false;
+  if (!registered)
+    {
+      atexit (kernel_clear);
+      registered = true;
+    }
+
+  Kernel *K = malloc (sizeof *K);
+
+  K->m = m;
+  K->solvent = malloc (m * sizeof (Site));
+  memcpy (K->solvent, solvent, m * sizeof (Site));
+  K->pd = *HD->PD;
+  K->settings = scm_gc_protect_object (guile_get_settings ());
+  K->comm = comm_world_petsc;
+
+  K->buf = NULL;
+  if (chi_fft_buf)
+    {
+      const size_t size = m * m * HD->PD->nrad * sizeof (real);
+      K->buf = malloc (size);
+      memcpy (K->buf, chi_fft_buf, size);
+    }
+
+  radial_grid (HD->PD, chi_fft_buf, &K->nrad, &K->rmax);
+
+  solvent_tables1 (HD, m, solvent, chi_fft_buf,
+                   &K->nrad, &K->dk, &K->chi, &K->tau);
+
+  if (kernels_size < MAX_KERNELS)
+    kernels_size++;
+  else
+    kernel_free (kernels[kernels_next]);
+
+  kernels[kernels_next] = K;
+  kernels_next = (kernels_next + 1) % MAX_KERNELS;
+
+  return K;
+}
+
+
+/*
+  Same as solvent_tables1() but taking the tables from the cache. The
+  caller is still supposed to free() the copies in *chi and *tau:
+*/
+static void
+solvent_tables (State *HD, int m, const Site solvent[m], /* in */
+                const real *chi_fft_buf, /* NULL, or [m][m][nrad] */
+                int *nrad_, real *dk_,   /* out */
+                real **chi, real **tau)  /* out, [m][m][nrad], [m][nrad] */
+{
+  const Kernel *K = kernel_get (HD, m, solvent, chi_fft_buf);
+
+  const int nrad = K->nrad;
+
+  *nrad_ = nrad;
+  *dk_ = K->dk;
+
+  *chi = malloc (m * m * nrad * sizeof (real));
+  *tau = malloc (m * nrad * sizeof (real));
+
+  memcpy (*chi, K->chi, m * m * nrad * sizeof (real));
+  memcpy (*tau, K->tau, m * nrad * sizeof (real));
+}
+
+
+/* Tabulates the cached 1D tables on the 3D k-grid: */
+static void
+kernel_tabulate (State *HD, const Kernel *K,
+                 Vec x3d[K->m][K->m], /* out, complex */
+                 Vec t3d[K->m])       /* out, complex */
+{
+  const int m = K->m;
+  const int nrad = K->nrad;
+  const real dk = K->dk;
+  const real (*x_fft)[m][nrad] = (void*) K->chi;
+  const real (*t_fft)[nrad] = (void*) K->tau;
 
   /*
     We choose  not to translate  the distribution to the  grid center,
@@ -1523,7 +2112,7 @@ solvent_kernel_rism (State *HD, int m, const Site solvent[m], /* in */
     the latter (m -> m).
   */
   for (int i = 0; i < m; i++)
-    vec_ktab (HD, nrad, t_fft[i], dk, tau_fft[i]);
+    vec_ktab (HD, nrad, t_fft[i], dk, t3d[i]);
 
   /*
     By now in each of m  3D tables tau_fft[i] we have an approximation
@@ -1539,24 +2128,28 @@ solvent_kernel_rism (State *HD, int m, const Site solvent[m], /* in */
     to scale the dimensionless addition by -β/ε₀, see iterate_t1().
   */
 
-  double (*const view)[m][m][nrad] = (void*) chi_fft_buf;
-
   /*
-    The solute/solvent code expects χ - 1.  Offset the diagonal before
-    tabulating on the  3D grid.  FIXME: assuming symmetric  χ - 1 with
-    aliasing:
+    Tabulate χ - 1 on the 3D grid.  FIXME: assuming symmetric χ - 1
+    with aliasing:
   */
-  real table[nrad];
   for (int i = 0; i < m; i++)
     for (int j = 0; j <= i; j++)
-      {
-        for (int k = 0; k < nrad; k++)
-          table[k] = (*view)[i][j][k] - delta (i, j);
-        vec_ktab (HD, nrad, table, dk, chi_fft[i][j]);
-      }
+      vec_ktab (HD, nrad, x_fft[i][j], dk, x3d[i][j]);
+}
 
-  if (!caller_supplied_chi)
-    free ((void*) chi_fft_buf);
+
+/* Layed off  from solvent_kernel().  Puts χ -  1 into  chi_fft[][] as
+   computed by 1d RISM solvent solver. See ./rism.f90. */
+static void
+solvent_kernel_rism (State *HD, int m, const Site solvent[m], /* in */
+                     const real *chi_fft_buf, /* NULL, or [m][m][nrad] */
+                     Vec chi_fft[m][m],       /* out, corner */
+                     Vec tau_fft[m])          /* out, corner */
+{
+  /* The 1D RISM runs only if not a cache hit, see kernel_get(): */
+  const Kernel *K = kernel_get (HD, m, solvent, chi_fft_buf);
+
+  kernel_tabulate (HD, K, chi_fft, tau_fft);
 }
 
 
@@ -1662,43 +2255,6 @@ energy (State *HD, int m, const Site solvent[m],
 }
 
 
-static real
-energy1 (State *HD,
-         int m, const Site solvent[m],
-         int n, const Site solute[n],
-         Vec h[m],               /* in */
-         real dx[n][3])          /* in */
-{
-  local Vec dv[m];
-  vec_create1 (HD->da, m, dv);
-
-  /* Compute differential dv of the solute field: */
-  bgy3d_solute_field1 (HD, m, solvent, n, solute, dx, dv);
-
-  local Vec g = vec_create (HD->da);
-  const real dN = HD->PD->rho * volume_element (HD->PD);
-
-  real de = 0.0;
-  for (int i = 0; i < m; i++)
-    {
-      /* Differential  dv  is singular,  g  ~  exp(-βv) is  negligibly
-         small. See how it works together: */
-      VecCopy (h[i], g);
-      VecShift (g, 1.0);
-      /* PRINTF ("XXX: min(dv) = %f max(dv) = %f\n", vec_min (dv[i]), vec_max (dv[i])); */
-      /* PRINTF ("XXX: min(g) = %f max(g) = %f\n", vec_min (g), vec_max (g)); */
-
-      de += vec_dot (g, dv[i]) * dN;
-      /* PRINTF ("XXX: pass\n"); */
-    }
-
-  vec_destroy1 (m, dv);
-  vec_destroy (&g);
-
-  return de;
-}
-
-
 /* Set [i, j] element of an array  to 1, the rest to zero. Do you miss
    Fortran? */
 static void
@@ -1730,15 +2286,26 @@ gradients (State *HD,
            Vec h[m],            /* in */
            real de[n][3])       /* out */
 {
-  real dx[n][3];
+  /*
+    Differential  dv  is singular,  g  ~  exp(-βv) is  negligibly
+    small. See how it works together. Weights ρ g dV for all solvent
+    sites and forces on all solute sites in one pass:
+  */
+  local Vec g[m];
+  vec_create1 (HD->da, m, g);
 
-  for (int i = 0; i < n; i++)
-    FOR_DIM
-      {
-        /* Choose a mode vector: */
-        set_x (n, 3, dx, i, dim);
-        de[i][dim] = energy1 (HD, m, solvent, n, solute, h, dx);
-      }
+  const real dN = HD->PD->rho * volume_element (HD->PD);
+
+  for (int i = 0; i < m; i++)
+    {
+      VecCopy (h[i], g[i]);
+      VecShift (g[i], 1.0);
+      VecScale (g[i], dN);
+    }
+
+  bgy3d_solute_field_grad (HD, m, solvent, n, solute, g, de);
+
+  vec_destroy1 (m, g);
 }
 
 
@@ -1779,9 +2346,22 @@ hnc3d_solute_solve (const ProblemData *PD,
   /* Derivatives by linear response (expensive): */
   bool response = false;
 
+  /*
+    Evaluate χ - 1 and τ on the fly from the 1D tables instead of
+    storing m (m + 1) / 2 + m complex 3D grids:
+  */
+  bool radial_kernels = false;
+
   /* Update if specified by user, or leave as is: */
   bgy3d_getopt_bool ("derivatives", &derivatives);
   bgy3d_getopt_bool ("response", &response);
+  bgy3d_getopt_bool ("radial-kernels", &radial_kernels);
+
+  if (radial_kernels && bgy3d_getopt_test ("solvent-3d"))
+    {
+      PRINTF ("(--radial-kernels ignored with --solvent-3d)\n");
+      radial_kernels = false;
+    }
 
 
   /* Code used to be verbose: */
@@ -1860,7 +2440,6 @@ hnc3d_solute_solve (const ProblemData *PD,
       artifacts). We are wasting here quite some memory!
     */
     local Vec chi_fft[m][m];
-    vec_create2 (HD->dc, m, chi_fft); /* complex */
 
     /*
       This one  will hold site-specific  renormalization χ * uc  as an
@@ -1869,17 +2448,48 @@ hnc3d_solute_solve (const ProblemData *PD,
       is capable of doing that.
     */
     local Vec tau_fft[m];
-    vec_create1 (HD->dc, m, tau_fft); /* complex */
 
     /*
       Get  the solvent-solvent  susceptibility  (offset by  one) as  a
       matrix of complex Vecs chi_fft[m][m]. The kernel derived from 1D
       RISM is  capable or supplying an array  of renormalization terms
-      in tau_fft[m] in addition. Others just fill them with zeroes:
+      in tau_fft[m] in addition. Others just fill them with zeroes.
+      With --radial-kernels keep the 1D tables instead:
     */
     bool renorm;
-    solvent_kernel (HD, m, solvent, chi_fft_buf,
-                    chi_fft, tau_fft, &renorm);
+    Radial *radial = NULL;
+    if (radial_kernels)
+      {
+        int nrad;
+        real dk, *chi, *tau;
+        solvent_tables (HD, m, solvent, chi_fft_buf, &nrad, &dk, &chi, &tau);
+
+        /* The flag --no-renorm for debugging only: */
+        renorm = !bgy3d_getopt_test ("no-renorm");
+
+        /* Copies the tables, tabulates the form factor for τ: */
+        radial = hnc3d_radial_create (HD, m, nrad, dk, (void*) chi,
+                                      renorm ? (void*) tau : NULL,
+                                      n, solute);
+        free (chi);
+        free (tau);
+
+        /* No 3D storage, NULLs because declared local: */
+        for (int i = 0; i < m; i++)
+          {
+            tau_fft[i] = NULL;
+            for (int j = 0; j < m; j++)
+              chi_fft[i][j] = NULL;
+          }
+      }
+    else
+      {
+        vec_create2 (HD->dc, m, chi_fft); /* complex */
+        vec_create1 (HD->dc, m, tau_fft); /* complex */
+
+        solvent_kernel (HD, m, solvent, chi_fft_buf,
+                        chi_fft, tau_fft, &renorm);
+      }
 
     /*
       Now  chi_fft[][] contains  χ  -  1 and  tau_fft[],  if the  flag
@@ -1890,7 +2500,9 @@ hnc3d_solute_solve (const ProblemData *PD,
       weighted by their charge we  apply the convolution with the form
       factor here:
     */
-    if (!renorm)
+    if (radial)
+      ;                         /* see hnc3d_radial_tau() */
+    else if (!renorm)
       vec_destroy1 (m, tau_fft); /* dont keep zeroes around */
     else
       {
@@ -1948,6 +2560,8 @@ hnc3d_solute_solve (const ProblemData *PD,
     {
       /* Work  area for iterate_t1().  If and  only if  ctx->renorm is
          false then ctx->v_long_fft will be used. */
+      real alpha[m];
+
       Ctx1 ctx =
         {
           .renorm = renorm,     /* use tau_fft[] or v_long_fft */
@@ -1962,16 +2576,46 @@ hnc3d_solute_solve (const ProblemData *PD,
           .c_fft = c_fft,             /* [m], work for c(t) */
           .t_fft = t_fft,             /* [m], work for t(c(t))) */
           .tau_fft = tau_fft,         /* [m] complex, in, or junk */
+          .radial = radial,           /* NULL, or in */
+          .alpha = alpha,             /* [m], work for precond_t1() */
         };
 
-      bgy3d_snes_default (PD, &ctx, (VecFunc1) iterate_t1, (VecFunc2) jacobian_t1, T);
+      /*
+        Mixed precision.  Far from convergence single precision FFTs
+        are accurate enough.  Iterate  with those until the residual
+        drops below --single-tol, then continue in double precision.
+        Float rounding limits how low the residual can get, so the
+        tolerance is clamped.  At most half of the iterations are
+        spent here:
+      */
+      {
+        real single_tol = 0.0;
+        bgy3d_getopt_real ("single-tol", &single_tol);
+
+        if (single_tol > 0.0 && single_tol < 100 * FLT_EPSILON)
+          single_tol = 100 * FLT_EPSILON;
+
+        if (single_tol > PD->norm_tol)
+          {
+            ProblemData pd = *PD;
+            pd.norm_tol = single_tol;
+            pd.max_iter = PD->max_iter / 2;
+
+            PRINTF ("(single precision FFT down to norm %g)\n", single_tol);
+
+            bgy3d_fft_mat_single (HD->fft_mat, true);
+            bgy3d_snes_default_pc (&pd, &ctx, (VecFunc1) iterate_t1, (VecFunc2) jacobian_t1,
+                                   (VecFunc2) precond_t1, T);
+            bgy3d_fft_mat_single (HD->fft_mat, false);
+          }
+      }
+
+      bgy3d_snes_default_pc (PD, &ctx, (VecFunc1) iterate_t1, (VecFunc2) jacobian_t1,
+                             (VecFunc2) precond_t1, T);
 
       /* XXX: Derivatives by linear response: */
       if (response)
         {
-          local Vec dV = vec_duplicate (T);
-          local Vec dT = vec_duplicate (T);
-
           /*
             FIXME: we need a lot of staff to compute chem. potential,
             here:  t, c,  h.  Why not  making  it a  functional of  t
@@ -2022,89 +2666,134 @@ hnc3d_solute_solve (const ProblemData *PD,
           /* Mode vector, and final cartesian gradient: */
           real dR[n][3], dE[n][3];
 
-          for (int i = 0; i < n; i++)
-            FOR_DIM
-              {
-                PRINTF ("XXX: doing i,j = %d,%d\n", i, dim);
-                /* Choose a mode vector: */
-                set_x (n, 3, dR, i, dim);
+          /*
+            Modes in batches of --response-batch, the linear equations
+            for a batch are solved together, see response_t1():
+          */
+          int batch = 4;
+          bgy3d_getopt_int ("response-batch", &batch);
+          assert (batch > 0);
+
+          /* Work arrays of jacobian_t1_many() for the largest batch: */
+          ctx.k = MIN (batch, 3 * n);
+          local Vec c_many[ctx.k * m];
+          local Vec c_fft_many[ctx.k * m], t_fft_many[ctx.k * m];
+          vec_create1 (HD->da, ctx.k * m, c_many);
+          vec_create1 (HD->dc, ctx.k * m, c_fft_many);
+          vec_create1 (HD->dc, ctx.k * m, t_fft_many);
+          ctx.c_many = c_many;
+          ctx.c_fft_many = c_fft_many;
+          ctx.t_fft_many = t_fft_many;
+
+          ctx.check = bgy3d_getopt_test ("response-check");
+
+          for (int p0 = 0; p0 < 3 * n; p0 += batch)
+            {
+              const int kb = MIN (batch, 3 * n - p0);
 
-                /* Compute differential dV of the solute field: */
+              local Vec dV[kb], dT[kb];
+              for (int q = 0; q < kb; q++)
                 {
+                  dV[q] = vec_duplicate (T);
+                  dT[q] = vec_duplicate (T);
+                }
+
+              for (int q = 0; q < kb; q++)
+                {
+                  const int i = (p0 + q) / 3, dim = (p0 + q) % 3;
+
+                  PRINTF ("XXX: doing i,j = %d,%d\n", i, dim);
+                  /* Choose a mode vector: */
+                  set_x (n, 3, dR, i, dim);
+
+                  /* Compute differential dV of the solute field: */
                   local Vec dv[m];
-                  vec_aliases_create1 (dV, m, dv);
+                  vec_aliases_create1 (dV[q], m, dv);
 
                   show_x (n, 3, dR);
                   bgy3d_solute_field1 (HD, m, solvent, n, solute, dR, dv);
-                  vec_aliases_destroy1 (dV, m, dv);
+                  vec_aliases_destroy1 (dV[q], m, dv);
                 }
 
-                response_t1 (&ctx, T, dV, dT);
-                PRINTF ("XXX: done\n");
+              response_t1 (&ctx, T, kb, dV, dT);
+              PRINTF ("XXX: done\n");
 
+              for (int q = 0; q < kb; q++)
                 {
-                  local Vec t[m], dt[m], dv[m];
-                  vec_aliases_create1 (T, m, t);
-                  vec_aliases_create1 (dT, m, dt);
-                  vec_aliases_create1 (dV, m, dv);
-
-                  for (int i = 0; i < m; i++)
-                    {
-                      VecWAXPY (dx[i], -PD->beta, dv[i], dt[i]);
-                      /* Closure equation h = f(-βv + t), is
-                         implemented as c = f(-βv + t) - t */
-                      compute_c1 (PD->closure, PD->beta, v_short[i], t[i], dx[i], dc[i]);
-                      VecAXPY (dc[i], -PD->beta, dv[i]);
-                      VecWAXPY (dh[i], 1.0, dc[i], dt[i]);
+                  const int i = (p0 + q) / 3, dim = (p0 + q) % 3;
+
+                  {
+                    local Vec t[m], dt[m], dv[m];
+                    vec_aliases_create1 (T, m, t);
+                    vec_aliases_create1 (dT[q], m, dt);
+                    vec_aliases_create1 (dV[q], m, dv);
+
+                    for (int i = 0; i < m; i++)
                       {
-                        const real dV = volume_element (PD);
-                        const real dN = dV * PD->rho;
-                        PRINTF ("XXX: |dx[%d]| = %f\n", i, vec_norm (dx[i]));
-                        PRINTF ("XXX: |dh[%d]| = %f\n", i, vec_norm (dh[i]));
-                        PRINTF ("XXX: |dc[%d]| = %f\n", i, vec_norm (dc[i]));
-                        PRINTF ("XXX: <dh[%d]> = %f\n", i, vec_sum (dh[i]) * dN);
-                        PRINTF ("XXX: <h[%d]> = %f\n", i, vec_sum (h[i]) * dN);
-                        PRINTF ("XXX: <dv[%d]> = %f\n", i, vec_sum (dv[i]) * dV);
-                        PRINTF ("XXX: <v[%d]> = %f\n", i, vec_sum (v_short[i]) * dV);
-                        PRINTF ("XXX: <dv²[%d]> = %f\n", i, 2 * vec_dot (v_short[i], dv[i]) * dV);
-                        PRINTF ("XXX: <v²[%d]> = %f\n", i, vec_dot (v_short[i], v_short[i]) * dV);
-                        PRINTF ("XXX: <dt[%d]> = %f\n", i, vec_sum (dt[i]) * dV);
-                        PRINTF ("XXX: <t[%d]> = %f\n", i, vec_sum (t[i]) * dV);
-                        local Vec f = vec_duplicate (v_short[i]);
-                        mayer (PD->beta, v_short[i], f);
-                        PRINTF ("XXX: <f[%d]> = %f\n", i, vec_sum (f) * dN);
-                        VecShift (f, 1.0);
-                        PRINTF ("XXX: <df[%d]> = %f\n", i, vec_dot (f, dv[i]) * (-PD->beta * dN));
-                        vec_destroy (&f);
+                        VecWAXPY (dx[i], -PD->beta, dv[i], dt[i]);
+                        /* Closure equation h = f(-βv + t), is
+                           implemented as c = f(-βv + t) - t */
+                        compute_c1 (PD->closure, PD->beta, v_short[i], t[i], dx[i], dc[i]);
+                        VecAXPY (dc[i], -PD->beta, dv[i]);
+                        VecWAXPY (dh[i], 1.0, dc[i], dt[i]);
+                        {
+                          const real dV = volume_element (PD);
+                          const real dN = dV * PD->rho;
+                          PRINTF ("XXX: |dx[%d]| = %f\n", i, vec_norm (dx[i]));
+                          PRINTF ("XXX: |dh[%d]| = %f\n", i, vec_norm (dh[i]));
+                          PRINTF ("XXX: |dc[%d]| = %f\n", i, vec_norm (dc[i]));
+                          PRINTF ("XXX: <dh[%d]> = %f\n", i, vec_sum (dh[i]) * dN);
+                          PRINTF ("XXX: <h[%d]> = %f\n", i, vec_sum (h[i]) * dN);
+                          PRINTF ("XXX: <dv[%d]> = %f\n", i, vec_sum (dv[i]) * dV);
+                          PRINTF ("XXX: <v[%d]> = %f\n", i, vec_sum (v_short[i]) * dV);
+                          PRINTF ("XXX: <dv²[%d]> = %f\n", i, 2 * vec_dot (v_short[i], dv[i]) * dV);
+                          PRINTF ("XXX: <v²[%d]> = %f\n", i, vec_dot (v_short[i], v_short[i]) * dV);
+                          PRINTF ("XXX: <dt[%d]> = %f\n", i, vec_sum (dt[i]) * dV);
+                          PRINTF ("XXX: <t[%d]> = %f\n", i, vec_sum (t[i]) * dV);
+                          local Vec f = vec_duplicate (v_short[i]);
+                          mayer (PD->beta, v_short[i], f);
+                          PRINTF ("XXX: <f[%d]> = %f\n", i, vec_sum (f) * dN);
+                          VecShift (f, 1.0);
+                          PRINTF ("XXX: <df[%d]> = %f\n", i, vec_dot (f, dv[i]) * (-PD->beta * dN));
+                          vec_destroy (&f);
+                        }
                       }
-                    }
-
-
-                  real mu0 = chempot (HD, PD->closure,
-                                      1, m,
-                                      (void*) x,
-                                      (void*) h,
-                                      (void*) c,
-                                      (void*) cl);
-                  real mu1 = chempot1 (HD, PD->closure,
-                                       1, m,
-                                       (void*) x, (void*) dx,
-                                       (void*) h, (void*) dh,
-                                       (void*) c, (void*) dc,
-                                       (void*) cl);
-                  dE[i][dim] = mu1;
-
-                  PRINTF ("XXX: mu0 = %f\n", mu0);
-                  PRINTF ("XXX: mu1 = %f\n", mu1);
-
-                  vec_aliases_destroy1 (T, m, t);
-                  vec_aliases_destroy1 (dT, m, dt);
-                  vec_aliases_destroy1 (dV, m, dv);
+
+
+                    real mu0 = chempot (HD, PD->closure,
+                                        1, m,
+                                        (void*) x,
+                                        (void*) h,
+                                        (void*) c,
+                                        (void*) cl);
+                    real mu1 = chempot1 (HD, PD->closure,
+                                         1, m,
+                                         (void*) x, (void*) dx,
+                                         (void*) h, (void*) dh,
+                                         (void*) c, (void*) dc,
+                                         (void*) cl);
+                    dE[i][dim] = mu1;
+
+                    PRINTF ("XXX: mu0 = %f\n", mu0);
+                    PRINTF ("XXX: mu1 = %f\n", mu1);
+
+                    vec_aliases_destroy1 (T, m, t);
+                    vec_aliases_destroy1 (dT[q], m, dt);
+                    vec_aliases_destroy1 (dV[q], m, dv);
+                  }
                 }
-              }
 
-          vec_destroy (&dV);
-          vec_destroy (&dT);
+              for (int q = 0; q < kb; q++)
+                {
+                  vec_destroy (&dV[q]);
+                  vec_destroy (&dT[q]);
+                }
+            }
+
+          vec_destroy1 (ctx.k * m, c_many);
+          vec_destroy1 (ctx.k * m, c_fft_many);
+          vec_destroy1 (ctx.k * m, t_fft_many);
+
           vec_destroy1 (m, x);
           vec_destroy1 (m, dx);
           vec_destroy1 (m, h);
@@ -2139,13 +2828,16 @@ hnc3d_solute_solve (const ProblemData *PD,
     vec_destroy1 (m, t_fft);
 
     /* Either one or another should be used: */
-    if (renorm)
-      vec_destroy1 (m, tau_fft);
-    else
+    if (!renorm)
       vec_destroy (&uc_fft);
+    else if (!radial)
+      vec_destroy1 (m, tau_fft);
 
     /* This should have been the only pair quantity: */
-    vec_destroy2 (m, chi_fft);
+    if (radial)
+      hnc3d_radial_destroy (radial);
+    else
+      vec_destroy2 (m, chi_fft);
   }
 
   /*
@@ -3,53 +3,216 @@
   Copyright (c) 2013 Alexei Matveev
 */
 
+#include "bgy3d.h"
+#include "bgy3d-fftw.h"         /* bgy3d_fft_planner() */
 #include <fftw3.h>
 #include <assert.h>
 #include "rism-dst.h"
 
+/*
+  Plan m  transforms of length  n, see fftw_plan_many_r2r(). Planners
+  other  than  FFTW_ESTIMATE  overwrite  the arrays  while  planning,
+  therefore, in  this case, plan on  scratch storage and  use the plan
+  with the new-array  execute interface, fftw_execute_r2r(). The  plan
+  is only valid for arrays of the same alignment:
+*/
+static fftw_plan
+plan_many (int n, int m, int stride, int dist, double *in, double *out)
+{
+  const fftw_r2r_kind kind = FFTW_RODFT11;
+  unsigned flags = bgy3d_fft_planner ();
+
+  if (flags == FFTW_ESTIMATE)
+    return fftw_plan_many_r2r (1, &n, m, /* rank, dimensions[rank], howmany */
+                               in, NULL, stride, dist, /* inp, ?, istride, idist */
+                               out, NULL, stride, dist, /* out, ?, ostride, odist */
+                               &kind, flags); /* kind, flags */
+
+  /* Scratch arrays are aligned, the arguments maybe not: */
+  if (fftw_alignment_of (in) || fftw_alignment_of (out))
+    flags |= FFTW_UNALIGNED;
+
+  double *in_ = fftw_alloc_real (n * m);
+  double *out_ = (out == in) ? in_ : fftw_alloc_real (n * m);
+
+  fftw_plan plan =
+    fftw_plan_many_r2r (1, &n, m, in_, NULL, stride, dist,
+                        out_, NULL, stride, dist, &kind, flags);
+
+  if (out_ != in_)
+    fftw_free (out_);
+  fftw_free (in_);
+
+  return plan;
+}
+
+
+/*
+  Plans are  cached. The 1D solver transforms arrays of the same shape
+  several times per  iteration, planning anew is as expensive as the
+  transform itself or, with a  planner other than FFTW_ESTIMATE, much
+  more  expensive. A  plan may be used  with the new-array interface
+  for arrays of  the same alignment and the same in-place-ness.  This
+  is all that distinguishes two plans for the same layout:
+*/
+typedef struct
+{
+  int n, m, stride, dist;       /* layout */
+  bool inplace;
+  int align_in, align_out;      /* fftw_alignment_of() */
+  fftw_plan plan;
+} Entry;
+
+/* FIFO eviction when full, there are rarely more than a few shapes: */
+#define MAX_PLANS 16
+static Entry cache[MAX_PLANS];
+static int cache_size = 0, cache_next = 0;
+
+/* See scratch() below: */
+static double *scratch_buf = NULL;
+static size_t scratch_capacity = 0;
+
+
+/* Run by exit(), also frees the scratch of rism_dst_rows(): */
+static void
+cache_clear (void)
+{
+  for (int i = 0; i < cache_size; i++)
+    fftw_destroy_plan (cache[i].plan);
+
+  cache_size = 0;
+  cache_next = 0;
+
+  fftw_free (scratch_buf);      /* maybe NULL */
+  scratch_buf = NULL;
+  scratch_capacity = 0;
+}
+
+
+static fftw_plan
+plan_cached (int n, int m, int stride, int dist, double *in, double *out)
+{
+  const Entry key =
+    {.n = n, .m = m, .stride = stride, .dist = dist,
+     .inplace = (in == out),
+     .align_in = fftw_alignment_of (in),
+     .align_out = fftw_alignment_of (out),
+     .plan = NULL};
+
+  for (int i = 0; i < cache_size; i++)
+    {
+      const Entry *e = &cache[i];
+      if (e->n == key.n && e->m == key.m &&
+          e->stride == key.stride && e->dist == key.dist &&
+          e->inplace == key.inplace &&
+          e->align_in == key.align_in && e->align_out == key.align_out)
+        return e->plan;
+    }
+
+  fftw_plan plan = plan_many (n, m, stride, dist, in, out);
+  assert (plan != NULL);
+
+  /*
+    The  first  call  to  plan_many()  registers  fftw_mpi_cleanup()
+    with atexit(). Handlers run in reverse order, so this one destroys
+    the plans before:
+  */
+  static bool registered = false;
+  if (!registered)
+    {
+      atexit (cache_clear);
+      registered = true;
+    }
+
+  Entry *e = &cache[cache_next];
+  if (cache_size < MAX_PLANS)
+    cache_size++;
+  else
+    fftw_destroy_plan (e->plan);
+
+  *e = key;
+  e->plan = plan;
+  cache_next = (cache_next + 1) % MAX_PLANS;
+
+  return plan;
+}
+
+
+/*
+  Aligned scratch  for the transposed copy in  rism_dst_rows(), grows
+  as needed and is kept for the next call.  Freed by cache_clear():
+*/
+static double *
+scratch (size_t size)
+{
+  if (size > scratch_capacity)
+    {
+      fftw_free (scratch_buf);
+      scratch_buf = fftw_alloc_real (size);
+      scratch_capacity = size;
+    }
+  return scratch_buf;
+}
+
+
+/* Cache-blocked out[j][i] = in[i][j], in is n x m: */
+static void
+transpose (int n, int m, const double in[n][m], double out[m][n])
+{
+  const int B = 32;
+
+  for (int i0 = 0; i0 < n; i0 += B)
+    for (int j0 = 0; j0 < m; j0 += B)
+      {
+        const int i1 = (i0 + B < n) ? i0 + B : n;
+        const int j1 = (j0 + B < m) ? j0 + B : m;
+
+        for (int i = i0; i < i1; i++)
+          for (int j = j0; j < j1; j++)
+            out[j][i] = in[i][j];
+      }
+}
+
+
 void rism_dst (size_t n, double out[n], const double in[n])
 {
   /* FIXME: does it write to in[]? */
-  fftw_plan plan = fftw_plan_r2r_1d (n, (double*) in, out, FFTW_RODFT11, FFTW_ESTIMATE);
-
-  fftw_execute (plan);
+  fftw_plan plan = plan_cached (n, 1, 1, n, (double*) in, out);
 
-  fftw_destroy_plan (plan);
+  fftw_execute_r2r (plan, (double*) in, out);
 }
 
 /* Transform m continous arrays each  of length n. In Fortran terms do
    FFT for each column of the n x m matrix buf(:, :). */
 void rism_dst_columns (int m, int n, double buf[m][n])
 {
-  const fftw_r2r_kind kind = FFTW_RODFT11;
-
-  fftw_plan plan =
-    fftw_plan_many_r2r (1, &n, m, /* rank, dimensions[rank], howmany */
-                        (double*) buf, NULL, 1, n, /* inp, ?, istride, idist */
-                        (double*) buf, NULL, 1, n, /* out, ?, ostride, odist */
-                        &kind, FFTW_ESTIMATE); /* kind, flags */
-  assert (plan != NULL);
+  fftw_plan plan = plan_cached (n, m, 1, n, /* stride, dist */
+                                (double*) buf, (double*) buf);
 
-  fftw_execute (plan);
-
-  fftw_destroy_plan (plan);
+  fftw_execute_r2r (plan, (double*) buf, (double*) buf);
 }
 
 
-/* Transform m stride-m  arrays each of length n.  In Fortran terms do
-   FFT for each row of the m x n matrix buf(:, :). */
+/*
+  Transform m stride-m  arrays each of length n.  In Fortran terms do
+  FFT for each row of the m x n matrix buf(:, :).  Strided transforms
+  of length n walk the whole  buffer m times. Instead, transpose into
+  contiguous scratch, do a batch of contiguous transforms there, and
+  transpose back. Two extra passes over memory are cheap in comparison.
+*/
 void rism_dst_rows (int n, int m, double buf[n][m])
 {
-  const fftw_r2r_kind kind = FFTW_RODFT11;
+  if (m == 1)
+    {
+      rism_dst_columns (1, n, (void*) buf);
+      return;
+    }
 
-  fftw_plan plan =
-    fftw_plan_many_r2r (1, &n, m, /* rank, dimensions[rank], howmany */
-                        (double*) buf, NULL, m, 1, /* inp, ?, istride, idist */
-                        (double*) buf, NULL, m, 1, /* out, ?, ostride, odist */
-                        &kind, FFTW_ESTIMATE); /* kind, flags */
-  assert (plan != NULL);
+  double (*tmp)[n] = (void*) scratch ((size_t) n * m);
+
+  transpose (n, m, buf, tmp);
 
-  fftw_execute (plan);
+  rism_dst_columns (m, n, tmp);
 
-  fftw_destroy_plan (plan);
+  transpose (m, n, (void*) tmp, (void*) buf);
 }
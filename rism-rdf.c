@@ -5,12 +5,12 @@
 
 #include "bgy3d.h"              /* State */
 #include "bgy3d-vec.h"          /* vec_create() */
-#include "bgy3d-fftw.h"         /* bgy3d_fft_interp() */
+#include "bgy3d-nufft.h"        /* bgy3d_nufft_interp() */
 #include "bgy3d-interp.h"       /* bgy3d_interp() */
 #include "lebed/lebed.h"        /* genpts() */
 
 
-/* Flip this to use expensive trigonometric interpolation: */
+/* Flip this to use trigonometric interpolation, prone to ringing: */
 static bool trilinear = true;
 
 void
@@ -24,14 +24,20 @@ rism_rdf (State *dom, Vec g,
 
   /* Prepare Fourier coefficients.  Only needed for trigonometric
      interpolation: */
-  local Vec g_fft = NULL;
+  Nufft *nu = NULL;
   if (!trilinear)
     {
-      g_fft = vec_create (dom->dc);
+      local Vec g_fft = vec_create (dom->dc);
 
       MatMult (dom->fft_mat, g, g_fft);
       /* Do not VecScale (g_fft, volume_element (PD)), the
          interpolation code assumes that ... */
+
+      /* Same for all radial layers, the only FFT on the fine grid: */
+      nu = bgy3d_nufft_create (PD->N, dom->dc, 1.0e-10);
+      bgy3d_nufft_set (nu, g_fft);
+
+      vec_destroy (&g_fft);
     }
 
   /* Coordinates  and weights of  spherical quadrature.  Only mm  <= m
@@ -52,12 +58,12 @@ rism_rdf (State *dom, Vec g,
         FOR_DIM
           y[i][dim] = (a[dim] + r[j] * x[i][dim] + PD->L[dim] / 2) / PD->h[dim];
 
-      /* NOTE:  trigonometric  interpolation   is  O(N^3)  per  point,
-         trilinear is O(1): */
+      /* NOTE: trilinear  interpolation is O(1) per point, so is the
+         fast trigonometric one after the FFT above: */
       if (trilinear)
         bgy3d_interp (dom->da, g, mm, y, gr);
       else
-        bgy3d_fft_interp (dom->fft_mat, g_fft, mm, y, gr);
+        bgy3d_nufft_interp (nu, mm, y, gr);
 
       /* Scale by integration weights: */
       for (int i = 0; i < mm; i++)
@@ -68,5 +74,5 @@ rism_rdf (State *dom, Vec g,
     }
 
   if (!trilinear)
-    vec_destroy (&g_fft);
+    bgy3d_nufft_destroy (nu);
 }
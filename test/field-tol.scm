@@ -0,0 +1,56 @@
+;;;
+;;; Copyright (c) 2014 Alexei Matveev
+;;;
+;;;  ../bgy3d -L ../ -s ./field-tol.scm
+;;;
+;;; Forces with --field-tol should  match the reference without cutoff.
+;;; The  differential of the  solute field is off  by at most tol at
+;;; every grid point,  the weights ρ g dV add  up to about ρL³ g, with
+;;; g < 2 for this solute. Exits with non-zero status otherwise.
+;;;
+(use-modules
+ (guile bgy3d)                       ; hnc3d-run-solute
+ (guile molecule)                    ; find-molecule
+ (srfi srfi-1)
+ (ice-9 pretty-print))
+
+(define *tol* 1.0e-3)
+
+(define *settings*
+  '((L . 10.0)
+    (N . 32)
+    (rho . 0.0333295)
+    (beta . 1.6889)
+    (norm-tol . 1.0e-12)
+    (derivatives . #t)
+    (response . #t)
+    (closure . HNC)
+    (verbosity . 0)))
+
+(define *solvent* (find-molecule "OW"))
+
+;;; Two LJ sites, see forces.scm:
+(define *solute*
+  '("OW2" (("OW" (0.0 0.0 1.0) 3.16 0.1549 0.0)
+           ("OW" (0.0 0.0 -1.0) 3.16 0.1549 0.0))))
+
+;;; Returns gradients computed in two different ways:
+(define (forces tol)
+  (let* ((settings (env-set 'field-tol tol *settings*))
+         (alist (hnc3d-run-solute *solute* *solvent* settings))
+         (g (assoc-ref alist 'free-energy-gradient))
+         (r (assoc-ref alist 'free-energy-response)))
+    (destroy alist)
+    (list g r)))
+
+(define (max-diff a b)
+  (apply max (map abs (map - (concatenate a) (concatenate b)))))
+
+(let* ((ref (forces 0.0))
+       (cut (forces *tol*))
+       (L (env-ref *settings* 'L))
+       (rho (env-ref *settings* 'rho))
+       (bound (* *tol* rho L L L 2))
+       (errors (map max-diff ref cut)))
+  (pretty-print/serial (list 'ERRORS: errors 'BOUND: bound))
+  (exit (every (lambda (e) (<= e bound)) errors)))
@@ -0,0 +1,34 @@
+#!/bin/sh
+#
+# Compare the numbers in two summary or table files within a tolerance.
+# Usage:
+#
+#   numdiff.sh old new rtol atol
+#
+# Fails unless |old - new| <= rtol |old| + atol for all numbers, taken
+# in order  of appearance.  Prints the  offending pairs. Comment lines,
+# starting with ";" or "#", and the text around the numbers are ignored.
+#
+old=$1
+new=$2
+rtol=${3:-0.0}
+atol=${4:-0.0}
+
+awk -v rtol=$rtol -v atol=$atol '
+    /^[;#]/ { next }
+    {
+        while (match ($0, /-?[0-9]+(\.[0-9]+)?([eE][-+]?[0-9]+)?/)) {
+            x = substr ($0, RSTART, RLENGTH)
+            $0 = substr ($0, RSTART + RLENGTH)
+            if (FNR == NR) a[na++] = x; else b[nb++] = x
+        }
+    }
+    END {
+        if (na != nb) { print "numdiff: " na " vs " nb " numbers"; exit 1 }
+        for (i = 0; i < na; i++) {
+            d = a[i] - b[i]; if (d < 0) d = -d
+            s = a[i]; if (s < 0) s = -s
+            if (d > rtol * s + atol) { print "numdiff: " a[i] " " b[i]; bad = 1 }
+        }
+        exit bad
+    }' $old $new